@@ -49,6 +49,7 @@ OMMotorFunctions::OMMotorFunctions(int p_stp=0, int p_dir=0, int p_slp=0, int p_
 
 
     m_asyncSteps = 0;
+    m_limitLeft = 0;
     m_contSpd = 0;
     m_desiredContSpd = 1000.0;
     m_stepsMoved = 0;
@@ -99,6 +100,7 @@ OMMotorFunctions::OMMotorFunctions(int p_stp=0, int p_dir=0, int p_slp=0, int p_
     m_splineOne.accel_steps = 0;
     m_splineOne.decel_steps = 0;
     m_splineOne.cruise_steps = 0;
+    m_splineOne.fd_state = OM_EASE_FD_NONE;
 
     m_splinePlanned.accel_fraction = 0.0;
     m_splinePlanned.decel_fraction = 0.0;
@@ -109,6 +111,8 @@ OMMotorFunctions::OMMotorFunctions(int p_stp=0, int p_dir=0, int p_slp=0, int p_
     m_splinePlanned.accel_steps = 0;
     m_splinePlanned.decel_steps = 0;
     m_splinePlanned.cruise_steps = 0;
+    m_splinePlanned.fd_state = OM_EASE_FD_NONE;
+    m_easeSpline = 0;
 
     m_refresh = true;
 
@@ -145,9 +149,96 @@ OMMotorFunctions::OMMotorFunctions(int p_stp=0, int p_dir=0, int p_slp=0, int p_
     m_calcMove = false;
     m_maxSpeed = 1000;
 
+    m_feedOn = false;
+    m_feedEpoch = 0;
+    m_feed = 1.0;
+    m_feedTarget = 1.0;
+    m_feedPos = 0.0;
+    m_maxAccel = OM_MOT_DEF_ACCEL;
+    m_maxJerk = OM_MOT_DEF_JERK;
+
     splineReady = false;
     endOfMove = false;
 
+#ifdef OM_MOT_STEP_TABLE
+    m_stepTable = 0;
+    m_tblSize = 0;
+    m_tblHead = 0;
+    m_tblTail = 0;
+    m_tblActive = false;
+    m_tblCompiled = false;
+    m_tblSpline = 0;
+    m_tblUnderruns = 0;
+#endif
+
+    m_usLow = 0;
+    m_usSpline = 0;
+    m_usTarget = 0;
+    m_usErrAccumulated = 0;
+    m_stepPeriod = 0;
+
+    m_cmpClock = OM_MOT_CMP_CLOCK;
+    m_cmpStep = false;
+    m_cmpEval = false;
+    m_cmpLeft = 0;
+    m_cmpTicks = 0;
+
+    profileReset();
+
+    m_splineGen = 0;
+    m_splineUsed = 0;
+    m_splineBusy = false;
+    m_splineEpoch = 0;
+    m_splineMissed = 0;
+
+    m_planBuf = 0;
+    m_planBufSize = 0;
+    m_planBytes = 0;
+    m_planSched = false;
+    m_planSum = 0;
+    m_planCheck = 0;
+    m_planPos = 0;
+    m_planLeft = 0;
+    m_planIdx = 0;
+    m_planMap = 0;
+    m_planBase = 0;
+
+#ifdef OM_MOT_STEP_TRACE
+    m_trace = 0;
+    m_traceSize = 0;
+    m_traceHead = 0;
+    m_traceTail = 0;
+    m_traceTicks = 0;
+    m_traceUs = 0;
+    m_traceDropped = 0;
+#endif
+
+#ifdef OM_MOT_TRIGGERS
+    m_trig = 0;
+    m_trigSize = 0;
+    m_trigCount = 0;
+    m_trigLo = 0;
+    m_trigHi = 0;
+    f_trigSignal = 0;
+#endif
+
+    m_evHead = 0;
+    m_evTail = 0;
+    m_evDropped = 0;
+
+#ifdef OM_MOT_SEGMENTS
+    m_segQueue = 0;
+    m_segSize = 0;
+    m_segHead = 0;
+    m_segTail = 0;
+    m_segReady = false;
+    m_segSteps = 0;
+    m_segSplines = 0;
+#endif
+
+    m_retarget = false;
+    m_retargetPos = 0;
+
 
 void(*f_motSignal)(uint8_t) = 0;
 
@@ -300,6 +391,7 @@ void OMMotorFunctions::dir( uint8_t p_Dir ) {
     // set new dir value
     m_curDir = p_Dir;
     m_asyncWasdir = m_curDir;
+    _recheckLimit();
   }
 
 }
@@ -311,8 +403,13 @@ void OMMotorFunctions::dir( uint8_t p_Dir ) {
  without having to query the method to see if a given action is still occuring.
 
  By passing a function pointer to this method, that function will be executed
- at each one of these moments, and passed a single, one byte argument that
- matches the signal which is to be sent.  The template for this function is:
+ after each one of these moments, and passed a single, one byte argument that
+ matches the signal which is to be sent.  Signals raised in the stepping
+ cycle are queued as they happen, and the function is called by poll() (see
+ the \ref motevents "Motor Events" section), so it must be called regularly
+ from the main loop.  Signals raised by methods called from the main loop are
+ passed on before the method returns.
+ The template for this function is:
 
  @code
  void function(byte val) { }
@@ -347,6 +444,8 @@ void setup() {
 
 void loop() {
 
+ Motor.poll();
+
  if( ! Motor.running() ) {
   delay(1000);
   Serial.println("Moving!");
@@ -380,10 +479,80 @@ void OMMotorFunctions::setHandler( void(*p_Func)(uint8_t) ) {
     f_motSignal = p_Func;
 }
 
+/** Poll Events
+
+ Passes each queued motor signal, fired position trigger and debug message on
+ to its handler, in the order they happened.  Call this method from the main
+ loop.  See the \ref motevents "Motor Events" section.
+
+ */
+
+void OMMotorFunctions::poll() {
+
+    while( m_evTail != m_evHead ) {
+
+        s_event ev = m_events[m_evTail];
+
+            // release the entry before the handler can queue more
+        m_evTail = m_evTail < OM_MOT_EVENTS ? m_evTail + 1 : 0;
+
+        if( ev.kind == OM_MOT_EVT_SIGNAL ) {
+            if( f_motSignal != 0 )
+                f_motSignal(ev.code);
+        }
+#ifdef OM_MOT_TRIGGERS
+        else if( ev.kind == OM_MOT_EVT_TRIGGER ) {
+            if( f_trigSignal != 0 )
+                f_trigSignal(ev.code);
+        }
+#endif
+        else {
+            USBSerial.print("Limit violation ");
+            USBSerial.println(ev.code, DEC);
+        }
+    }
+}
+
+/** Get Dropped Events
+
+ Returns the number of events lost because the queue was full.
+
+ @return
+ Count of dropped events
+ */
+
+unsigned int OMMotorFunctions::eventsDropped() {
+    return(m_evDropped);
+}
+
 void OMMotorFunctions::_fireCallback(uint8_t p_Param) {
-    if( f_motSignal != 0 ) {
-        f_motSignal(p_Param);
+    _queueEvent(OM_MOT_EVT_SIGNAL, p_Param);
+
+        // signals raised from the main loop reach the handler at once, as
+        // they always have; interrupts are only disabled here in the
+        // stepping cycle or an atomic section, which must not be delayed
+    if( SREG & _BV(SREG_I) )
+        poll();
+}
+
+ // queue an event for poll(), from either the stepping cycle or the main loop
+void OMMotorFunctions::_queueEvent(uint8_t p_kind, uint8_t p_code) {
+
+    uint8_t oldSREG = SREG;
+    cli();
+
+    uint8_t head = m_evHead;
+    uint8_t next = head < OM_MOT_EVENTS ? head + 1 : 0;
+
+    if( next == m_evTail )
+        m_evDropped++;
+    else {
+        m_events[head].kind = p_kind;
+        m_events[head].code = p_code;
+        m_evHead = next;
     }
+
+    SREG = oldSREG;
 }
 
 
@@ -532,6 +701,67 @@ float OMMotorFunctions::contSpeed() {
     return(m_contSpd);
 }
 
+/** Set Feed Rate Override
+
+  Scales the speed of moves by the given percentage, including any move
+  already running.  See the \ref feedrate "Feed Rate Override" section.
+
+  A running move changes speed gradually, by up to OM_MOT_FEED_SLEW of its
+  planned speed per spline, following the same profile faster or slower from
+  the point it has reached.  Values outside of OM_MOT_FEED_MIN to
+  OM_MOT_FEED_MAX are limited to that range.
+
+  An override above 100% saturates at maxSpeed() and maxStepRate(): it raises
+  no speed past the lower of the two, and leaves a speed planned above that
+  as it was planned.
+
+  @param p_Percent
+  Feed rate, as a percentage of the planned speed (100 = as planned)
+  */
+
+void OMMotorFunctions::feedRate(uint8_t p_Percent) {
+
+    if( p_Percent < OM_MOT_FEED_MIN )
+        p_Percent = OM_MOT_FEED_MIN;
+    else if( p_Percent > OM_MOT_FEED_MAX )
+        p_Percent = OM_MOT_FEED_MAX;
+
+    m_feedTarget = p_Percent / 100.0;
+
+        // nothing is moving, so there is nothing to slew
+    if( ! running() )
+        m_feed = m_feedTarget;
+
+    if( m_feedTarget == 1.0 && m_feed == 1.0 && ! running() ) {
+        m_feedOn = false;
+        return;
+    }
+
+    if( ! m_feedOn ) {
+#ifdef OM_MOT_STEP_TABLE
+            // the remaining splines of the current move are calculated
+            // as they are needed from here on
+        uint8_t oldSREG = SREG;
+        cli();
+        m_tblActive = false;
+        SREG = oldSREG;
+#endif
+
+        m_feedEpoch = m_splineEpoch - 1;
+        m_feedOn = true;
+    }
+}
+
+/** Get Feed Rate Override
+
+  @return
+  Feed rate being applied (or moved towards), as a percentage of the planned speed
+  */
+
+uint8_t OMMotorFunctions::feedRate() {
+    return( (uint8_t) (m_feedTarget * 100.0 + 0.5) );
+}
+
 
 /** Set Continuous Motion Mode
 
@@ -578,6 +808,8 @@ void setup() {
 
 void loop() {
 
+ Motor.poll();
+
  if( ! Motor.running() ) {
 
   delay(1000);
@@ -682,6 +914,9 @@ Updates the next spline for continous speed. This is a linear acceleration and d
 
 
 void OMMotorFunctions::_updateContSpeed(){
+
+    OM_MOT_PROFILE_SCOPE(this, OM_MOT_PROF_CONTSPD);
+
     if (m_switchDir){
 
         //decelerate until you're within half of the m_contAccelRate step/sec of stop
@@ -722,19 +957,38 @@ void OMMotorFunctions::_updateContSpeed(){
        m_backCheck = false;
     }
 
+    float desired = m_desiredContSpd * m_feedTarget;
+
+        // the override raises the speed no higher than maxSpeed() and
+        // maxStepRate(), and never lowers it below that asked for
+    if( m_feedTarget > 1.0 ) {
+        float top = maxStepRate();
+
+        if( m_maxSpeed < top )
+            top = m_maxSpeed;
+
+        if( top < abs(m_desiredContSpd) )
+            top = abs(m_desiredContSpd);
+
+        if( desired > top )
+            desired = top;
+        else if( desired < -top )
+            desired = -top;
+    }
+
     //current speed is less than the desired speed
-    if (m_contSpd <= (m_desiredContSpd - m_contAccelRate)){
+    if (m_contSpd <= (desired - m_contAccelRate)){
 
         m_contSpd += m_contAccelRate;
 
     //current speed is greater than the desired speed
-    } else if (m_contSpd >= (m_desiredContSpd + m_contAccelRate)){
+    } else if (m_contSpd >= (desired + m_contAccelRate)){
 
         m_contSpd -= m_contAccelRate;
 
     //we're within 25 steps/second of the desired speed, close enough to jump to desired
     } else {
-        m_contSpd = m_desiredContSpd;
+        m_contSpd = desired;
         if (m_desiredContSpd == 0.0 || m_contSpd == 0.0)
             stop();
     }
@@ -755,6 +1009,13 @@ void OMMotorFunctions::_updateContSpeed(){
          // figure out how many cycles we delay after each step
     float off_time = g_cyclesPerSpline / (curSpd);
 
+        // no faster than one step per cycle
+    if( off_time < 1.0 ) {
+        m_nextOffCycles = 1;
+        m_nextCycleErr = 0;
+        return;
+    }
+
     m_nextOffCycles = (unsigned long) off_time;
     //multiple the error by the FLOAT_TOLERANCE to get rid of the float variable
     m_nextCycleErr = (off_time - (unsigned long) off_time)*FLOAT_TOLERANCE;
@@ -875,7 +1136,8 @@ long OMMotorFunctions::maxSteps() {
  your input will be ignored.
 
  This method has no effect on the six-argument form of move(), plan(), planRun(),
- or continuous motion movements.
+ or continuous motion movements, except that a feed rate override (see feedRate())
+ does not raise their speed past it.
 
  @param p_Speed
  Maximum speed, in steps per second
@@ -902,6 +1164,76 @@ unsigned int OMMotorFunctions::maxSpeed() {
     return(m_maxSpeed);
 }
 
+/** Set Maximum Acceleration
+
+ Sets the highest acceleration (and deceleration) the two- and three-argument
+ forms of move() may use, and therefore home(), moveTo() and the moves of an
+ SMS plan.  These moves are solved for the shortest time in which the distance
+ can be covered without exceeding this acceleration, the jerk limit set by
+ maxJerk() or the speed set by contSpeed().  See the \ref mintime
+ "Minimum-Time Moves" section.
+
+ The limit applies to the peak acceleration of the easing curve in use, so
+ quadratic easing, which ends (or begins) its ramps at twice the average
+ acceleration, takes longer ramps than linear easing for the same limit.
+
+ Values of zero or less are ignored.  The default is OM_MOT_DEF_ACCEL.
+
+ This method has no effect on the five-argument form of move(), plan(), or
+ continuous motion movements.
+
+ @param p_Accel
+ Maximum acceleration, in steps per second per second
+ */
+
+void OMMotorFunctions::maxAccel(float p_Accel) {
+    if( p_Accel <= 0.0 )
+        return;
+
+    m_maxAccel = p_Accel;
+}
+
+/** Get Maximum Acceleration
+
+ @return
+ Maximum acceleration of simple moves, in steps per second per second
+ */
+
+float OMMotorFunctions::maxAccel() {
+    return(m_maxAccel);
+}
+
+/** Set Maximum Jerk
+
+ Sets the highest rate of change of acceleration simple moves may use (see
+ maxAccel()).  Only S-curve easing brings its acceleration up gradually, so
+ the jerk limit has no effect with any other easing mode.
+
+ A value of zero removes the jerk limit, negative values are ignored.  The
+ default is OM_MOT_DEF_JERK.
+
+ @param p_Jerk
+ Maximum jerk, in steps per second per second per second
+ */
+
+void OMMotorFunctions::maxJerk(float p_Jerk) {
+    if( p_Jerk < 0.0 )
+        return;
+
+    m_maxJerk = p_Jerk;
+}
+
+/** Get Maximum Jerk
+
+ @return
+ Maximum jerk of simple moves, in steps per second per second per second, or
+ zero if there is no jerk limit
+ */
+
+float OMMotorFunctions::maxJerk() {
+    return(m_maxJerk);
+}
+
 /** Set Maximum Stepping Rate
 
  Sets the maximum rate at which steps can be taken.
@@ -1046,6 +1378,11 @@ void OMMotorFunctions::plan(unsigned long p_Shots, uint8_t p_Dir, unsigned long
     // prep spline variables (using planned mode)
     _initSpline(true, p_Dist, p_Shots, p_Accel, p_Decel);
 
+    m_planSched = false;
+
+    if( m_planBuf != 0 )
+        m_planSched = _compilePlan(p_Dist, p_Accel, p_Decel);
+
 }
 
 /** Execute the Next Iteration of the Current Plan
@@ -1148,12 +1485,18 @@ void OMMotorFunctions::planRun() {
     }
 
     m_curPlanSpline++;
-    
-    // Determine how far through the move we are
-    float tmPos = ((float) m_curPlanSpline) / (float) m_curPlanSplines;
-    
-    // get steps to move for next movement
-    f_easeFunc(true, tmPos, this); // sets m_curPlanSpd
+
+    if( m_planSched ) {
+        // read steps for next movement from the schedule
+        m_curPlanSpd = _planNext();
+    }
+    else {
+        // Determine how far through the move we are
+        om_ease_t tmPos = _easePercent(m_curPlanSpline, m_curPlanSplines);
+
+        // get steps to move for next movement
+        f_easeFunc(true, tmPos, this); // sets m_curPlanSpd
+    }
     
     move(m_planDir, m_curPlanSpd);
 
@@ -1176,9 +1519,14 @@ void OMMotorFunctions::planReverse() {
 
     // get steps to move for last movement (m_curPlanSpline is not changed)
 
-    float tmPos = (float) m_curPlanSpline / (float) m_curPlanSplines;
+    if( m_planSched ) {
+        m_curPlanSpd = _planSeek(m_curPlanSpline);
+    }
+    else {
+        om_ease_t tmPos = _easePercent(m_curPlanSpline, m_curPlanSplines);
 
-    f_easeFunc(true, tmPos, this); // sets m_curPlanSpd
+        f_easeFunc(true, tmPos, this); // sets m_curPlanSpd
+    }
         // note that direction is reversed
     move(!m_planDir, m_curPlanSpd);
 
@@ -1186,6 +1534,295 @@ void OMMotorFunctions::planReverse() {
 
     m_curPlanSpline = (m_curPlanSpline >= 1) ? m_curPlanSpline - 1 : m_curPlanSpline;
 
+        // and the schedule cursor with it
+    if( m_planSched )
+        _planSeek(m_curPlanSpline);
+
+}
+
+/** Set Plan Schedule Buffer
+
+ Supplies a buffer in which plan() stores the step count of every shot, so
+ that planRun() does not need to evaluate the easing curve.  See the
+ \ref planmoves "Planned and Interleaved Moves" section for more information.
+
+ The buffer is used from the next call to plan().  Pass a null pointer to
+ return to evaluating each shot in planRun().
+
+ @param p_buf
+ A pointer to an array of bytes
+
+ @param p_size
+ The size of the array, in bytes
+
+ */
+
+void OMMotorFunctions::planSchedule(uint8_t* p_buf, unsigned int p_size) {
+
+    m_planBuf = p_size > 0 ? p_buf : 0;
+    m_planBufSize = p_size;
+    m_planSched = false;
+    m_planBytes = 0;
+}
+
+/** Get Plan Schedule Status
+
+ Returns whether the current plan was compiled into the schedule buffer by
+ plan(), and is being run from it.
+
+ @return
+ true if the plan is being run from its schedule, false if not
+ */
+
+uint8_t OMMotorFunctions::planScheduled() {
+    return(m_planSched);
+}
+
+/** Get Plan Schedule Size
+
+ Returns the number of bytes of the schedule buffer used by the current plan.
+
+ @return
+ Bytes used
+ */
+
+unsigned int OMMotorFunctions::planScheduleSize() {
+    return(m_planSched ? m_planBytes : 0);
+}
+
+/** Get Plan Steps
+
+ Returns the total number of steps the current plan will take over all of
+ its shots, as calculated when it was compiled into the schedule.
+
+ @return
+ Total steps, or 0 if the plan has no schedule
+ */
+
+unsigned long OMMotorFunctions::planSteps() {
+    return(m_planSched ? m_planSum : 0);
+}
+
+/** Get Plan Checksum
+
+ Returns the Fletcher-16 checksum of the current plan's schedule, as
+ calculated when it was compiled.
+
+ @return
+ Checksum, or 0 if the plan has no schedule
+ */
+
+unsigned int OMMotorFunctions::planChecksum() {
+    return(m_planSched ? m_planCheck : 0);
+}
+
+/** Verify Plan Schedule
+
+ Reads back the entire schedule of the current plan, confirming that its
+ checksum is unchanged, that it holds exactly one entry per shot, and that
+ those entries sum to planSteps().
+
+ This does not change the current position in the plan.
+
+ @return
+ true if the schedule is intact, false if not or if the plan has no schedule
+ */
+
+uint8_t OMMotorFunctions::planVerify() {
+
+    if( ! m_planSched || _planChecksum() != m_planCheck )
+        return(false);
+
+    unsigned long sum = 0;
+
+    _planSeek(0);
+
+    for( unsigned long i = 0; i < m_curPlanSplines; i++ ) {
+        if( m_planLeft == 0 && m_planPos >= m_planBytes )
+            break;
+        sum += _planNext();
+    }
+
+    uint8_t ok = ( sum == m_planSum && m_planLeft == 0 && m_planPos == m_planBytes );
+
+    _planSeek(m_curPlanSpline);
+
+    return(ok);
+}
+
+ // evaluate every shot of the plan just initialised into the schedule buffer,
+ // then return the plan to its start.  Returns false if the buffer is too small.
+uint8_t OMMotorFunctions::_compilePlan(unsigned long p_Dist, unsigned long p_Accel, unsigned long p_Decel) {
+
+    s_planSeg seg;
+    unsigned long lastBase = 0;
+    uint8_t ok = true;
+
+    seg.len = 0;
+    m_planBytes = 0;
+    m_planSum = 0;
+
+    for( m_curPlanSpline = 1; ok && m_curPlanSpline <= m_curPlanSplines; m_curPlanSpline++ ) {
+
+        f_easeFunc(true, _easePercent(m_curPlanSpline, m_curPlanSplines), this);
+
+        unsigned long steps = m_curPlanSpd;
+        m_planSum += steps;
+
+            // a segment whose shots all took the same steps so far can
+            // still be moved down to one step fewer
+        if( seg.len > 0 && ! seg.extra && steps + 1 == seg.base ) {
+            seg.base = steps;
+            seg.extra = true;
+            for( unsigned int i = 0; i < seg.len; i++ )
+                seg.bits[i >> 3] |= 1 << (i & 7);
+        }
+
+        if( seg.len == 0 || seg.len >= 256 || steps < seg.base || steps > seg.base + 1 ) {
+            ok = _planFlush(&seg, &lastBase);
+            seg.base = steps;
+            seg.len = 0;
+            seg.extra = false;
+            memset(seg.bits, 0, sizeof(seg.bits));
+        }
+
+        if( steps > seg.base ) {
+            seg.bits[seg.len >> 3] |= 1 << (seg.len & 7);
+            seg.extra = true;
+        }
+
+        seg.len++;
+    }
+
+    if( ok )
+        ok = _planFlush(&seg, &lastBase);
+
+    m_planCheck = _planChecksum();
+
+        // evaluating the shots used up the plan, so start it again
+    m_curPlanSpd = 0;
+    m_curPlanErr = 0.0;
+    m_curPlanSpline = 0;
+    _initSpline(true, p_Dist, m_curPlanSplines, p_Accel, p_Decel);
+
+    _planSeek(0);
+
+    return(ok);
+}
+
+ // add one byte to the schedule, returns false if the buffer is full
+uint8_t OMMotorFunctions::_planPut(uint8_t p_byte) {
+
+    if( m_planBytes >= m_planBufSize )
+        return(false);
+
+    m_planBuf[m_planBytes++] = p_byte;
+    return(true);
+}
+
+ // write out a completed segment, p_lastBase holds the base of the segment
+ // before it
+uint8_t OMMotorFunctions::_planFlush(s_planSeg* p_seg, unsigned long* p_lastBase) {
+
+    if( p_seg->len == 0 )
+        return(true);
+
+    long delta = (long) p_seg->base - (long) *p_lastBase;
+    uint8_t map = p_seg->extra ? 0x80 : 0;
+    uint8_t ok;
+
+    *p_lastBase = p_seg->base;
+
+    if( delta >= -63 && delta <= 63 ) {
+        ok = _planPut(map | (delta & 0x7F));
+    }
+    else {
+        ok = _planPut(map | 0x40);
+        for( uint8_t i = 0; ok && i < 4; i++ )
+            ok = _planPut((p_seg->base >> (i * 8)) & 0xFF);
+    }
+
+    if( ok )
+        ok = _planPut(p_seg->len - 1);
+
+    if( p_seg->extra ) {
+        for( unsigned int i = 0; ok && i < (p_seg->len + 7) / 8; i++ )
+            ok = _planPut(p_seg->bits[i]);
+    }
+
+    return(ok);
+}
+
+ // read the step count of the next shot from the schedule
+unsigned long OMMotorFunctions::_planNext() {
+
+    if( m_planLeft == 0 ) {
+
+        uint8_t head = m_planBuf[m_planPos++];
+        int delta = head & 0x7F;
+
+        if( delta == 0x40 ) {
+            m_planBase = 0;
+            for( uint8_t i = 0; i < 4; i++ )
+                m_planBase |= (unsigned long) m_planBuf[m_planPos++] << (i * 8);
+        }
+        else {
+            if( delta & 0x40 )
+                delta -= 0x80;
+            m_planBase += delta;
+        }
+
+        m_planLeft = (unsigned int) m_planBuf[m_planPos++] + 1;
+        m_planIdx = 0;
+        m_planMap = 0;
+
+        if( head & 0x80 ) {
+            m_planMap = m_planPos;
+            m_planPos += (m_planLeft + 7) / 8;
+        }
+    }
+
+    unsigned long steps = m_planBase;
+
+    if( m_planMap != 0 && (m_planBuf[m_planMap + (m_planIdx >> 3)] & (1 << (m_planIdx & 7))) )
+        steps++;
+
+    m_planIdx++;
+    m_planLeft--;
+
+    return(steps);
+}
+
+ // move the schedule cursor to just after p_shot shots, returning the step
+ // count of the last of them (the schedule can only be read forwards)
+unsigned long OMMotorFunctions::_planSeek(unsigned long p_shot) {
+
+    unsigned long steps = 0;
+
+    m_planPos = 0;
+    m_planLeft = 0;
+    m_planIdx = 0;
+    m_planMap = 0;
+    m_planBase = 0;
+
+    for( unsigned long i = 0; i < p_shot; i++ )
+        steps = _planNext();
+
+    return(steps);
+}
+
+ // Fletcher-16 checksum of the compiled schedule
+unsigned int OMMotorFunctions::_planChecksum() {
+
+    unsigned int sum1 = 0;
+    unsigned int sum2 = 0;
+
+    for( unsigned int i = 0; i < m_planBytes; i++ ) {
+        sum1 = (sum1 + m_planBuf[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+
+    return( (sum2 << 8) | sum1 );
 }
 
 
@@ -1263,9 +1900,7 @@ void OMMotorFunctions::move(uint8_t p_Dir, unsigned long p_Dist, unsigned long p
 
         // we need to initialize the first spline point
     m_curSpline = 1;
-    float tmPos = (float) m_curSpline / (float) m_totalSplines;
-
-    f_easeFunc(false, tmPos, this);
+    _easeSpline(m_curSpline);
 
     m_calcMove = true;
 
@@ -1303,10 +1938,10 @@ void OMMotorFunctions::resumeMove(){
 
  For non-continuous motion, this form of move allows you to only specify the
  destination and direction (using saved parameters), and the motor will move as quickly as possible to
- the given destination, with acceleration and deceleration ramping occuring over
- 100 steps, or 1/4 of the total steps for the move - whichever is less.  The
- speed of this form of move is controlled by the lesser of maxStepRate() or
- maxSpeed().
+ the given destination without exceeding the speed set by contSpeed() (or
+ maxStepRate(), if lower), or the acceleration and jerk limits set by maxAccel()
+ and maxJerk().  See the \ref mintime "Minimum-Time Moves" section.  The
+ three-argument form, used for "send to..." moves, is solved the same way.
 
  If a move can be executed, asynchronous movement is initiated and the
  callback is called, with OM_MOT_BEGIN passed as the argument value.
@@ -1330,6 +1965,9 @@ void OMMotorFunctions::move(uint8_t p_Dir, unsigned long p_Steps) {
 
 void OMMotorFunctions::move(uint8_t p_Dir, unsigned long p_Steps, bool p_Send) {
 
+        // "send to..." moves are solved as any other, see above
+    (void) p_Send;
+
         // if motor is disabled, do nothing
    if( ! enable() || ( maxSteps() > 0 && stepsMoved() >= maxSteps() ) ) {
         _fireCallback(OM_MOT_DONE);
@@ -1382,10 +2020,6 @@ void OMMotorFunctions::move(uint8_t p_Dir, unsigned long p_Steps, bool p_Send) {
         // this move was not specified with a time to accomplish, so accomplish
         // in minimal amount of time possible
 
-         // determine how far we'd move in our acceleration and deceleration
-         // times for moves that must operate at maximum speed. We accelerate
-         // and decel over 200 steps each, or 1/4 of the total steps, whichever is less
-
         //check to see if there's a direction change
         m_asyncWasdir = dir();
         dir( p_Dir );
@@ -1403,34 +2037,17 @@ void OMMotorFunctions::move(uint8_t p_Dir, unsigned long p_Steps, bool p_Send) {
             // set travel const (.travel) here before attempting to use it
         _setEasingCoeff(&m_splineOne);
 
-        unsigned int mSpeed = abs(m_desiredContSpd);
+        float mSpeed = abs(m_desiredContSpd);
 
-        // Fixed acceleration/deceleration step length to use for "send to..." and SMS motor commands
-        const int ACCEL_DECEL_LENGTH_SEND = 4000;
-        const int ACCEL_DECEL_LENGTH_SMS = 500;
-        int accel_decel_length;
-
-        // If this is a "send to..." move (i.e. sending the motor to the start position, use a longer accel/decel length)
-        if (p_Send == true)
-            accel_decel_length = ACCEL_DECEL_LENGTH_SEND;
-        else
-            accel_decel_length = ACCEL_DECEL_LENGTH_SMS;
-
-
-        // This is the fixed acceleration/deceleration step length used for the "send to" commands.
-        float rampSteps = ((p_Steps / 2.0) < accel_decel_length) ? (p_Steps / 2.0) : accel_decel_length;
+        if( mSpeed > maxStepRate() )
+            mSpeed = maxStepRate();
 
+            // shortest move within the speed, acceleration and jerk limits
+            // ("send to..." moves and SMS moves share the same limits)
+        float mvMS;
+        float rampMS;
 
-        rampSteps *= 2.0;
-
-        //calculated cruise time
-        float cruise_fraction = ((p_Steps - rampSteps) / mSpeed) * 1000.0;
-
-        //calculate acceleration and deceleration time
-        float adTm = ((rampSteps / mSpeed) * 1000.0) * m_splineOne.easing_coeff;
-
-        //calculated total move time
-        float mvMS = (cruise_fraction + adTm);
+        _solveMove(p_Steps, mSpeed, m_splineOne.easing_coeff, &mvMS, &rampMS);
 
             // take a minimum of 50ms to make the move - to prevent over-speeding
             // and getting goofy.
@@ -1438,28 +2055,29 @@ void OMMotorFunctions::move(uint8_t p_Dir, unsigned long p_Steps, bool p_Send) {
             mvMS = 50.0;
         }
 
-            // calculated total number of splines during the move
-        //m_totalSplines = (unsigned long) mvMS / MS_PER_SPLINE;
-
             // prep spline variables
-        _initSpline(false, p_Steps, mvMS, adTm/2.0, adTm/2.0);
+        _initSpline(false, p_Steps, mvMS, rampMS, rampMS);
 
             // we need to initialize the first spline point
         m_curSpline = 1;
-        float tmPos = (float) m_curSpline / (float) m_totalSplines;
             // calculate the first running speed
-        f_easeFunc(false, tmPos, this);
+        _easeSpline(m_curSpline);
    }
 
     // limit step cycle using this control
     // value, without mucking with max steps
 
    m_asyncSteps = p_Steps;
+   _recheckLimit();
 
     // re-set called from five-argument flag
 
    m_calcMove = false;
 
+#ifdef OM_MOT_STEP_TABLE
+    // pre-calculate as much of the move as fits into the step table
+   _initStepTable();
+#endif
 
    _stepsAsync(p_Dir, p_Steps);
    _fireCallback(OM_MOT_MOVING);
@@ -1468,11 +2086,22 @@ void OMMotorFunctions::move(uint8_t p_Dir, unsigned long p_Steps, bool p_Send) {
 
 void OMMotorFunctions::stop() {
 
+    m_retarget = false;
+    clearQueue();
+    _stopMove();
+}
+
+ // end the current move, leaving any queued segments in place
+void OMMotorFunctions::_stopMove() {
+
         // set motors not moving in async mode
       m_isRun = false;
       m_refresh = true;
       endOfMove = false;
       splineReady = false;
+#ifdef OM_MOT_STEP_TABLE
+      m_tblActive = false;
+#endif
       m_motCont = false;
       m_contSpd = 0.0;
 
@@ -1481,8 +2110,10 @@ void OMMotorFunctions::stop() {
         digitalWrite(m_slp, OM_MOT_SSTATE);
 
 
-        // signal completion
-      _fireCallback(OM_MOT_DONE);
+        // signal completion, unless stopping only to turn back to a new
+        // target (see _retarget())
+      if( ! m_retarget )
+        _fireCallback(OM_MOT_DONE);
 
 }
 
@@ -1496,6 +2127,7 @@ void OMMotorFunctions::_stepsAsync( uint8_t p_Dir, unsigned long p_Steps ) {
 
 
          m_asyncSteps = p_Steps;
+         _recheckLimit();
          m_firstRun = true;
          //updateSpline();
 
@@ -1522,7 +2154,7 @@ void OMMotorFunctions::_stepsAsync( uint8_t p_Dir, unsigned long p_Steps ) {
  Sets the easing algorithm to be used for future moves.
 
  You may specify an easing type using the constants OM_MOT_LINEAR,
- OM_MOT_QUAD, and OM_MOT_QUADINV. Doing so will change the algorithm for future moves.
+ OM_MOT_QUAD, OM_MOT_QUADINV, and OM_MOT_SCURVE. Doing so will change the algorithm for future moves.
 
  You may not change the easing algorithm while a move is executing, attempting
  to do so will result in no change to the easing algorithm to prevent dangerous
@@ -1535,7 +2167,7 @@ void OMMotorFunctions::_stepsAsync( uint8_t p_Dir, unsigned long p_Steps ) {
  easing algorithms.
 
  @param p_easeType
- The type of easing algorithm to use, either OM_MOT_LINEAR, OM_MOT_QUAD, or OM_MOT_QUADINV.
+ The type of easing algorithm to use, either OM_MOT_LINEAR, OM_MOT_QUAD, OM_MOT_QUADINV, or OM_MOT_SCURVE.
 
  */
 
@@ -1548,6 +2180,7 @@ void OMMotorFunctions::easing(uint8_t p_easeType) {
 
   if( p_easeType == OM_MOT_LINEAR ) {
       f_easeFunc = _linearEasing;
+      f_easeCal = _linCalc;
   }
   else if( p_easeType == OM_MOT_QUAD ) {
       f_easeFunc = _quadEasing;
@@ -1557,12 +2190,20 @@ void OMMotorFunctions::easing(uint8_t p_easeType) {
       f_easeFunc = _quadEasing;
       f_easeCal = _qInvCalc;
   }
+  else if( p_easeType == OM_MOT_SCURVE ) {
+      f_easeFunc = _quadEasing;
+      f_easeCal = _sCurveCalc;
+  }
   else {
         // unsupported type
       return;
   }
 
   m_easeType = p_easeType;
+
+    // differences fitted to the last curve no longer apply
+  m_splineOne.fd_state = OM_EASE_FD_NONE;
+  m_splinePlanned.fd_state = OM_EASE_FD_NONE;
 }
 
 
@@ -1572,7 +2213,8 @@ void OMMotorFunctions::easing(uint8_t p_easeType) {
 
 
  @return
- Easing algorithm, linear is OM_MOT_LINEAR, quad is OM_MOT_QUAD, quad inv is OM_MOT_QUADINV
+ Easing algorithm, linear is OM_MOT_LINEAR, quad is OM_MOT_QUAD, quad inv is OM_MOT_QUADINV,
+ S-curve is OM_MOT_SCURVE
  */
 
 uint8_t OMMotorFunctions::easing() {
@@ -1605,6 +2247,7 @@ void OMMotorFunctions::clear() {
     m_curPlanErr = 0.0;
     m_curPlanSplines = 0;
     m_curPlanSpline = 0;
+    m_planSched = false;
 }
 
 
@@ -1623,7 +2266,67 @@ void OMMotorFunctions::_updateMotorHome(int p_Steps) {
 
   m_curPos += p_Steps;
 
-}
+    // one step closer to the nearest limit
+  if( m_limitLeft > 0 )
+      m_limitLeft--;
+
+#ifdef OM_MOT_STEP_TRACE
+  if( m_trace != 0 )
+      _traceStep();
+#endif
+
+#ifdef OM_MOT_TRIGGERS
+  if( m_trigCount > 0 )
+      _checkTriggers(p_Steps);
+#endif
+
+}
+
+#ifdef OM_MOT_STEP_TRACE
+
+ // record the step just taken in the trace buffer (stepping cycle only)
+void OMMotorFunctions::_traceStep() {
+
+    unsigned long ticks = m_traceTicks;
+
+    if( m_traceUs >= g_curSampleRate ) {
+        ticks += m_traceUs / g_curSampleRate;
+        m_traceUs %= g_curSampleRate;
+    }
+
+    m_traceTicks = 0;
+
+    uint16_t dir = m_curDir ? OM_MOT_TRACE_DIR : 0;
+
+        // gaps too long for one entry are carried by entries without a step
+    while( ticks >= OM_MOT_TRACE_GAP ) {
+        if( ! _tracePut(OM_MOT_TRACE_GAP | dir) )
+            return;
+        ticks -= OM_MOT_TRACE_GAP;
+    }
+
+    _tracePut(ticks | dir);
+}
+
+ // add one entry to the trace buffer, returns false if it was full
+uint8_t OMMotorFunctions::_tracePut(uint16_t p_entry) {
+
+    uint8_t next = m_traceHead + 1;
+    if( next >= m_traceSize )
+        next = 0;
+
+    if( next == m_traceTail ) {
+        m_traceDropped++;
+        return(false);
+    }
+
+    m_trace[m_traceHead] = p_entry;
+    m_traceHead = next;
+
+    return(true);
+}
+
+#endif
 
 /** Set Home Position
 
@@ -1632,11 +2335,23 @@ void OMMotorFunctions::_updateMotorHome(int p_Steps) {
  */
 
 void OMMotorFunctions::homeSet() {
+
+        // the stepping cycle checks the position against the limits and
+        // triggers, so they all move together
+    uint8_t oldSREG = SREG;
+    cli();
+
     if (m_endPos != 0)
         m_endPos -= m_curPos;
     m_startPos -= m_curPos;
     m_stopPos -= m_curPos;
     m_curPos = 0;
+    _recheckLimit();
+#ifdef OM_MOT_TRIGGERS
+    _seekTriggers();
+#endif
+
+    SREG = oldSREG;
 }
 
 /** Set End Position
@@ -1647,6 +2362,7 @@ void OMMotorFunctions::homeSet() {
 
 void OMMotorFunctions::endPos(long p_steps) {
     m_endPos = p_steps;
+    _recheckLimit();
 }
 
 /** Get End Position
@@ -1722,7 +2438,18 @@ long OMMotorFunctions::stopPos() {
 */
 
 void OMMotorFunctions::currentPos(long p_steps) {
+
+        // the stepping cycle checks the position against the triggers
+    uint8_t oldSREG = SREG;
+    cli();
+
     m_curPos = p_steps;
+    _recheckLimit();
+#ifdef OM_MOT_TRIGGERS
+    _seekTriggers();
+#endif
+
+    SREG = oldSREG;
 }
 
 /** Current Position
@@ -1744,8 +2471,8 @@ long OMMotorFunctions::currentPos() {
 
  Send motor home immediately.
 
- This method will not stop any ongoing move, but it will immediately send
- the motor back to its home position, and will result in an aborted move.
+ If the motor is already running a move, that move is re-planned to end at
+ the home position, see the \ref retarget "Retargeting Moves" section.
 
  Like other moves, this move is non-blocking and will trigger the callback
  to be executed with the OM_MOT_DONE argument when the send to home move
@@ -1762,8 +2489,8 @@ void OMMotorFunctions::home() {
 
  Send motor to start position immediately.
 
- This method will not stop any ongoing move, but it will immediately send
- the motor back to its start position, and will result in an aborted move.
+ If the motor is already running a move, that move is re-planned to end at
+ the start position, see the \ref retarget "Retargeting Moves" section.
 
  Like other moves, this move is non-blocking and will trigger the callback
  to be executed with the OM_MOT_DONE argument when the send to home move
@@ -1780,8 +2507,8 @@ void OMMotorFunctions::moveToStart() {
 
  Send motor to stop position immediately.
 
- This method will not stop any ongoing move, but it will immediately send
- the motor back to its stop position, and will result in an aborted move.
+ If the motor is already running a move, that move is re-planned to end at
+ the stop position, see the \ref retarget "Retargeting Moves" section.
 
  Like other moves, this move is non-blocking and will trigger the callback
  to be executed with the OM_MOT_DONE argument when the send to home move
@@ -1799,8 +2526,8 @@ void OMMotorFunctions::moveToStop() {
 
  Send motor to end position immediately.
 
- This method will not stop any ongoing move, but it will immediately send
- the motor back to its end position, and will result in an aborted move.
+ If the motor is already running a move, that move is re-planned to end at
+ the end position, see the \ref retarget "Retargeting Moves" section.
 
  Like other moves, this move is non-blocking and will trigger the callback
  to be executed with the OM_MOT_DONE argument when the send to home move
@@ -1820,12 +2547,14 @@ void OMMotorFunctions::moveToEnd() {
 
  Send motor to given position immediately using a simple move.
 
- This method will not stop any ongoing move, but it will immediately send
- the motor back to its home position, and will result in an aborted move.
+ If the motor is already running a move, that move is re-planned from the
+ motor's current speed to end at the new position, without stopping, and the
+ motor decelerates or turns back as needed within the acceleration and jerk
+ limits.  See the \ref retarget "Retargeting Moves" section.
 
  Like other moves, this move is non-blocking and will trigger the callback
- to be executed with the OM_MOT_DONE argument when the send to home move
- is completed.
+ to be executed with the OM_MOT_DONE argument when the motor reaches the
+ given position.
  */
 
 void OMMotorFunctions::moveTo(long p_pos) {
@@ -1836,6 +2565,12 @@ void OMMotorFunctions::moveTo(long p_pos) {
 // Same as above, but if the third parameter is true (indicating a "send to..." move), the move will execute with a longer accel/decel
 void OMMotorFunctions::moveTo(long p_pos, bool p_send) {
 
+    // a simple move already under way is re-planned, rather than restarted
+ if( running() && ! continuous() && _retarget(p_pos) )
+     return;
+
+ m_retarget = false;
+
  if( currentPos() == p_pos )
      return;
 
@@ -1856,6 +2591,305 @@ void OMMotorFunctions::moveTo(long p_pos, bool p_send) {
 
 }
 
+ /* re-plan the running move to end at p_pos, starting from the speed the motor
+    is at now.  If the motor can stop before p_pos, the new move carries on from
+    that speed as quickly as contSpeed(), maxAccel() and maxJerk() allow.  If
+    not, it is brought to rest as quickly as they allow, and updateSpline()
+    sends it back to p_pos from there.  Returns false if the motor has stopped,
+    and the move should be started from rest instead.
+
+  */
+
+uint8_t OMMotorFunctions::_retarget(long p_pos) {
+
+    uint8_t oldSREG = SREG;
+    cli();
+
+    unsigned long off = m_curOffCycles;
+    unsigned long err = m_curCycleErr;
+    uint8_t curDir = m_curDir;
+    long curPos = m_curPos;
+    unsigned long left = m_asyncSteps > m_stepsTaken ? m_asyncSteps - m_stepsTaken : 0;
+    uint8_t accelerating = _easePercent(m_curSpline, m_totalSplines) < m_splineOne.accel_fraction;
+
+    SREG = oldSREG;
+
+        // already on its way there
+    if( m_retarget ? p_pos == m_retargetPos : p_pos == (curDir == 1 ? curPos + (long) left : curPos - (long) left) )
+        return(true);
+
+        // speed now (steps / second), as planned - the feed rate override
+        // is applied on top of the new move as well
+    float speed = 0.0;
+
+    if( off > 0 && off < 1000000 )
+        speed = g_cyclesPerSpline / (off + (float) err / FLOAT_TOLERANCE) * (1000.0 / MS_PER_SPLINE);
+
+    if( m_feedOn )
+        speed /= m_feed;
+
+    float top = abs(m_desiredContSpd);
+
+    if( top > maxStepRate() )
+        top = maxStepRate();
+
+    s_splineCal spline;
+    _setEasingCoeff(&spline);
+
+    float coeff = spline.easing_coeff;
+    float stop = speed * _rampTime(speed) / coeff;
+    long ahead = curDir == 1 ? p_pos - curPos : curPos - p_pos;
+
+        // a target just inside the stopping distance is still reached without
+        // turning back, with a deceleration of up to twice the limit
+    if( ahead <= 0 || ahead < stop / 2.0 ) {
+
+            // slow enough to stop within a spline: moveTo() starts the new move
+            // from rest, so OM_MOT_DONE is only signalled if it is already there
+        if( speed <= m_maxAccel * MS_PER_SPLINE / 1000.0 ) {
+            m_retarget = ahead < 0;
+            _stopMove();
+            m_retarget = false;
+            return(false);
+        }
+
+        m_retargetPos = p_pos;
+
+            // the current move is already bringing it to rest
+        if( m_retarget )
+            return(true);
+
+        ahead = (long) ceil(stop);
+        top = speed;
+        m_retarget = true;
+    }
+    else
+        m_retarget = false;
+
+        // (a motor just over the speed limit is brought back to it)
+    float entry = speed < top ? speed : top;
+    float v = entry;
+    float accel = 0.0;
+    float decel = 0.0;
+
+        // quadratic and S-curve ramps start with no acceleration, so a motor
+        // part-way up one carries on along a ramp to the new top speed rather
+        // than starting another - otherwise a target moved every spline would
+        // restart the ramp every spline, and the motor would barely speed up
+    uint8_t carry = accelerating && ( m_easeType == OM_MOT_QUAD || m_easeType == OM_MOT_SCURVE );
+
+    if( ahead < stop ) {
+        decel = coeff * ahead / entry;
+    }
+    else {
+            // the fastest top speed for which both ramps fit...
+        float lo = entry;
+        float hi = top;
+
+        if( _retargetRamps(entry, hi, coeff, carry, &accel, &decel) > ahead ) {
+            for( uint8_t i = 0; i < 16; i++ ) {
+                float mid = (lo + hi) / 2.0;
+                if( _retargetRamps(entry, mid, coeff, carry, &accel, &decel) > ahead )
+                    hi = mid;
+                else
+                    lo = mid;
+            }
+            hi = lo;
+            lo = entry;
+        }
+
+            // ...and the top speed below it which takes the least time
+        for( uint8_t i = 0; i < 16; i++ ) {
+            float v1 = lo + (hi - lo) / 3.0;
+            float v2 = hi - (hi - lo) / 3.0;
+            float t1 = (ahead - _retargetRamps(entry, v1, coeff, carry, &accel, &decel)) / v1 + accel + decel;
+            float t2 = (ahead - _retargetRamps(entry, v2, coeff, carry, &accel, &decel)) / v2 + accel + decel;
+
+            if( t1 > t2 )
+                lo = v1;
+            else
+                hi = v2;
+        }
+
+        v = (lo + hi) / 2.0;
+    }
+
+        // each spline runs at the curve's speed at its end, which from a
+        // running start covers half a spline at the entry speed less than
+        // the curve itself: make it up with a little more cruise
+    float lead = entry * MS_PER_SPLINE / 2000.0;
+    float cruise = lead / v;
+
+    if( ahead >= stop )
+        cruise += (ahead - _retargetRamps(entry, v, coeff, carry, &accel, &decel)) / v;
+
+        // a carried-on ramp is planned from rest, with the part of it already
+        // behind the motor taken as whole splines
+    unsigned long behind = 0;
+    float behindSteps = 0.0;
+    float ramp = 0.0;
+
+    if( carry && ahead >= stop && v > entry ) {
+        ramp = _rampTime(v);
+        behind = (unsigned long) (_rampPoint(entry / v) * ramp * 1000.0 / MS_PER_SPLINE + 0.5);
+
+        float done = behind * MS_PER_SPLINE / 1000.0;
+
+        if( done > ramp )
+            done = ramp;
+
+        behindSteps = v * ramp * _rampCovered(done / ramp);
+        accel = ramp - done;
+    }
+
+    float tm = accel + cruise + decel;
+    unsigned long travel = (unsigned long) ceil(tm * 1000.0 / MS_PER_SPLINE) * MS_PER_SPLINE;
+
+    if( travel < MS_PER_SPLINE )
+        travel = MS_PER_SPLINE;
+
+        // spend the time added by rounding up to whole splines on a longer
+        // deceleration, so the top speed is kept
+    float spare = travel / 1000.0 - tm;
+    float longer = spare / (1.0 - 1.0 / coeff);
+
+    if( longer > cruise + spare )
+        longer = cruise + spare;
+
+    decel += longer;
+
+    travel += behind * MS_PER_SPLINE;
+
+    unsigned long accelMS = (unsigned long) ((behind > 0 ? ramp : accel) * 1000.0 + 0.5);
+    unsigned long decelMS = (unsigned long) (decel * 1000.0 + 0.5);
+
+    if( accelMS > travel )
+        accelMS = travel;
+    if( decelMS > travel - accelMS )
+        decelMS = travel - accelMS;
+
+    _initSpline(false, behindSteps + ahead + lead, travel, accelMS, decelMS, &spline);
+
+    if( behind == 0 )
+        _blendSpline(&spline, ahead + lead, travel, entry * MS_PER_SPLINE / 1000.0, 0.0);
+
+    clearQueue();
+
+    oldSREG = SREG;
+    cli();
+
+        // the move may have ended, or taken more steps, while planning
+    if( ! m_isRun ) {
+        SREG = oldSREG;
+        m_retarget = false;
+        return(false);
+    }
+
+    long moved = curDir == 1 ? m_curPos - curPos : curPos - m_curPos;
+
+    _startSpline(&spline, travel / MS_PER_SPLINE, ahead > moved ? ahead - moved : 1, behind + 1);
+
+    SREG = oldSREG;
+
+    return(true);
+}
+
+ // steps covered by the ramps of a move from p_Entry to p_Top and back to rest
+ // (steps / second), with the shortest ramp times allowed (seconds).  With
+ // p_Carry set, the acceleration is the rest of a ramp from rest to p_Top,
+ // from the point at which it passes p_Entry
+float OMMotorFunctions::_retargetRamps(float p_Entry, float p_Top, float p_Coeff, uint8_t p_Carry, float* p_Accel, float* p_Decel) {
+
+    *p_Decel = _rampTime(p_Top);
+
+    if( p_Carry && p_Top > p_Entry ) {
+        float from = _rampPoint(p_Entry / p_Top);
+
+        *p_Accel = *p_Decel * (1.0 - from);
+        return( p_Top * *p_Decel * (1.0 / p_Coeff - _rampCovered(from)) + p_Top * *p_Decel / p_Coeff );
+    }
+
+    *p_Accel = _rampTime(p_Top - p_Entry);
+
+    return( p_Entry * *p_Accel + (p_Top - p_Entry) * *p_Accel / p_Coeff + p_Top * *p_Decel / p_Coeff );
+}
+
+ // point (0.0 - 1.0) through an acceleration ramp of the current easing curve
+ // at which it reaches p_Fraction of its top speed
+float OMMotorFunctions::_rampPoint(float p_Fraction) {
+
+    if( p_Fraction <= 0.0 )
+        return(0.0);
+    if( p_Fraction >= 1.0 )
+        return(1.0);
+
+    if( m_easeType == OM_MOT_QUAD )
+        return( sqrt(p_Fraction) );
+
+    if( m_easeType == OM_MOT_QUADINV )
+        return( 1.0 - sqrt(1.0 - p_Fraction) );
+
+    if( m_easeType == OM_MOT_SCURVE ) {
+            // the inverse of each piece of _sCurveShape()
+        if( p_Fraction < 0.25 )
+            return( sqrt(p_Fraction) * 2.0 / 3.0 );
+        if( p_Fraction <= 0.75 )
+            return( (p_Fraction + 0.25) * 2.0 / 3.0 );
+        return( 1.0 - sqrt(1.0 - p_Fraction) * 2.0 / 3.0 );
+    }
+
+    return(p_Fraction);
+}
+
+ // steps covered up to point p_Point (0.0 - 1.0) through an acceleration ramp of
+ // the current easing curve, as a fraction of its top speed times its length -
+ // over the whole ramp this is 1 / easing_coeff
+float OMMotorFunctions::_rampCovered(float p_Point) {
+
+    if( p_Point <= 0.0 )
+        return(0.0);
+    if( p_Point > 1.0 )
+        p_Point = 1.0;
+
+    float left = 1.0 - p_Point;
+
+    if( m_easeType == OM_MOT_QUAD )
+        return( p_Point * p_Point * p_Point / 3.0 );
+
+    if( m_easeType == OM_MOT_QUADINV )
+        return( p_Point - (1.0 - left * left * left) / 3.0 );
+
+    if( m_easeType == OM_MOT_SCURVE ) {
+        if( p_Point < 1.0 / 3.0 )
+            return( 0.75 * p_Point * p_Point * p_Point );
+        if( p_Point <= 2.0 / 3.0 )
+            return( 1.0 / 36.0 + 0.75 * (p_Point * p_Point - 1.0 / 9.0) - 0.25 * (p_Point - 1.0 / 3.0) );
+        return( 0.5 - left + 0.75 * left * left * left );
+    }
+
+    return( p_Point * p_Point / 2.0 );
+}
+
+ // shortest ramp between rest and p_Speed (steps / second) allowed by maxAccel()
+ // and maxJerk() for the current easing curve, in seconds
+float OMMotorFunctions::_rampTime(float p_Speed) {
+
+    float ka;
+    float kj;
+
+    _rampPeaks(&ka, &kj);
+
+    float ramp = ka * p_Speed / m_maxAccel;
+
+    if( kj > 0.0 && m_maxJerk > 0.0 ) {
+        float jerk = sqrt(kj * p_Speed / m_maxJerk);
+        if( jerk > ramp )
+            ramp = jerk;
+    }
+
+    return(ramp);
+}
+
 /** Set Plan Type
 
 Variable to identify if a plan move is set and what type it is.
@@ -2120,49 +3154,11 @@ void OMMotorFunctions::programMove(){
 */
 
 
-void OMMotorFunctions::_linearEasing(uint8_t p_SMS, float p_move_percent, OMMotorFunctions* theFunctions) {
-
-    // Is this a plan move? If yes, use planned spline, otherwise use default start spline
-    OMMotorFunctions::s_splineCal *thisSpline = p_SMS == true ? &theFunctions->m_splinePlanned : &theFunctions->m_splineOne;
-
-    // Current continuous speed (steps/s) (CONT) or current SMS move steps (SMS)
-    float speed_steps = 0;
+void OMMotorFunctions::_linearEasing(uint8_t p_SMS, om_ease_t p_move_percent, OMMotorFunctions* theFunctions) {
 
-    // SMS moves
-    if (p_SMS){
-        // Determine whether we're currently in the accel/constant/decel phase,
-        // then assign move steps / speed based the current spline within the SMS moves
-        if (p_move_percent <= thisSpline->accel_fraction) {
-            speed_steps = thisSpline->accel_coeff * theFunctions->m_curPlanSpline;
-        }
-        else if (p_move_percent < thisSpline->decel_start) {
-            speed_steps = thisSpline->top_speed;
-        }
-        else {
-            // This should count down from the total decel moves to 1.
-            // Need to add 1, otherwise each move count is off by one and the last move is 0, which causes things to come out funky. 
-            // Basically, when that happens, what should be the first decel move ends up as the final move, which is way bad.
-            speed_steps = thisSpline->decel_coeff * (thisSpline->decel_moves - (theFunctions->m_curPlanSpline - thisSpline->accel_moves - thisSpline->cruise_moves) + 1);
-        }
-
-        // Calculate the error for SMS moves (and adjust movement to whole number)
-        _SMSErrorCalc(p_move_percent, speed_steps, thisSpline, theFunctions);
-    }
-
-    // Continuous moves
-    else{
-        // Determine whether we're currently in the accel/constant/decel phase,
-        // then assign move steps / speed based upon current position within that phase
-        if (p_move_percent <= thisSpline->accel_fraction)
-            speed_steps = thisSpline->top_speed * (p_move_percent / thisSpline->accel_fraction);
-        else if (p_move_percent < thisSpline->decel_start)
-            speed_steps = thisSpline->top_speed;
-        else 
-            speed_steps = thisSpline->top_speed * (1.0 - ((p_move_percent - thisSpline->accel_fraction - thisSpline->cruise_fraction) / thisSpline->decel_fraction));
+    OM_MOT_PROFILE_SCOPE(theFunctions, OM_MOT_PROF_LINEAR);
 
-        // Calculate the error for continuous moves
-        _contErrorCalc(p_move_percent, speed_steps, theFunctions);
-    }   
+    _easeSpeed(p_SMS, p_move_percent, theFunctions);
 }
 
 /* 
@@ -2186,149 +3182,461 @@ with type mismatches when I tried that.
 
 */
 
-void OMMotorFunctions::_quadEasing(uint8_t p_SMS, float p_move_percent, OMMotorFunctions* theFunctions) {
+void OMMotorFunctions::_quadEasing(uint8_t p_SMS, om_ease_t p_move_percent, OMMotorFunctions* theFunctions) {
+
+  // shared by quad, inv. quad and S-curve easing, which are timed separately
+  OM_MOT_PROFILE_SCOPE(theFunctions, OM_MOT_PROF_LINEAR + theFunctions->m_easeType - OM_MOT_LINEAR);
+
+  _easeSpeed(p_SMS, p_move_percent, theFunctions);
+}
+
+/*
+
+The easing work shared by all easing types: find the speed from the current
+curve (f_easeCal) and convert it to off cycles (continuous) or whole steps
+(SMS).
+
+*/
+
+void OMMotorFunctions::_easeSpeed(uint8_t p_SMS, om_ease_t p_move_percent, OMMotorFunctions* theFunctions) {
 
   // Select planned or default spline
   OMMotorFunctions::s_splineCal *thisSpline = p_SMS == true ? &theFunctions->m_splinePlanned : &theFunctions->m_splineOne;
-  
-  // Current continuous speed (steps/s) (CONT) or current SMS move steps (SMS)
-  float speed_steps = 0;    
 
-  // use correct quad or inv. quad calculation
-  speed_steps = (theFunctions->f_easeCal)(thisSpline, p_move_percent, theFunctions, p_SMS);
+  unsigned long index = p_SMS == true ? theFunctions->m_curPlanSpline : theFunctions->m_easeSpline;
+
+  // Current continuous speed (steps/s) (CONT) or current SMS move steps (SMS)
+  om_ease_t speed_steps = _easeStep(thisSpline, index, p_move_percent, theFunctions, p_SMS);
 
   // Calculate the error for continuous moves
   if( ! p_SMS )
       _contErrorCalc(p_move_percent, speed_steps, theFunctions);
 
   // Calculate the error for SMS moves (and adjust movement to whole number)
-  else
-      _SMSErrorCalc(p_move_percent, speed_steps, thisSpline, theFunctions);
+  else {
+      float move_steps = OM_EASE_FLOAT(speed_steps);
+      _SMSErrorCalc(p_move_percent, move_steps, thisSpline, theFunctions);
+  }
 }
 
-
 /*
 
-This function modifies a motor's error values for continuous moves.
+Returns the speed from the current easing curve at spline (or shot) p_n, of
+which p_move_percent is the move percentage.
 
-@p_move_percent:
-    A reference to a variable of the same name in the _linearEasing or _quadEasing functions. This is how far through
-    the total program the motor is currently
+When p_n follows on from the last spline evaluated, the speed comes from the
+forward differences fitted to the curve, otherwise the curve is evaluated
+directly.  Differences are fitted when the spline after a direct evaluation
+is reached, so a move started from the stepping cycle does not pay for the
+fit there.  Nor is any fit made with interrupts disabled: a spline which the
+stepping cycle has to calculate itself, after the main loop has missed its
+deadline, is evaluated directly and the fit left to the next spline the main
+loop calculates.  For continuous moves, the differences are also dropped
+whenever the stepping cycle starts a new move (m_splineEpoch changes).
 
-@p_cur_spd:
-    A reference to a variable of the same name in the _linearEasing or _quadEasing functions. This is the just-calculated
-    speed, in steps/second of the current continuous move.
+*/
 
-@theFunctions:
-    A pointer to the current motor object, passed through from either the _linearEasing or _quadEasing function..
+om_ease_t OMMotorFunctions::_easeStep(s_splineCal* thisSpline, unsigned long p_n, om_ease_t p_move_percent, OMMotorFunctions* theFunctions, uint8_t p_SMS) {
 
-*/
+    uint8_t epoch = p_SMS ? 0 : theFunctions->m_splineEpoch;
 
-void OMMotorFunctions::_contErrorCalc(const float& p_move_percent, float& p_cur_spd, OMMotorFunctions *theFunctions){
-    
-    float off_time = 1000000.0;     // 1 second worth of microseconds
+    if( p_n != thisSpline->fd_next || thisSpline->fd_epoch != epoch )
+        thisSpline->fd_state = OM_EASE_FD_NONE;
+    else if( thisSpline->fd_state == OM_EASE_FD_FIT && p_n > thisSpline->fd_end )
+        thisSpline->fd_state = OM_EASE_FD_PRIMED;
 
-    // If curSpd is very small, set to a small number to prevent dividing by 0
-    if (p_cur_spd <= 0.000001){
-        p_cur_spd = 0.000001;
-    }
-    // Otherwise, figure out how many cycles to delay after each step
-    else {
-        off_time = theFunctions->g_cyclesPerSpline / p_cur_spd;
-    }
+    if( thisSpline->fd_state == OM_EASE_FD_PRIMED && (SREG & _BV(SREG_I)) )
+        _easeFit(thisSpline, p_n, theFunctions, p_SMS);
 
-    // we can't track fractional off-cycles, so we need to have an error rate
-    // which we can accumulate between steps
-    theFunctions->m_nextOffCycles = (unsigned long)off_time;
-    if (theFunctions->m_nextOffCycles < 1){
-        theFunctions->m_nextOffCycles = 1;
+    if( thisSpline->fd_state != OM_EASE_FD_FIT ) {
+        thisSpline->fd_state = OM_EASE_FD_PRIMED;
+        thisSpline->fd_next = p_n + 1;
+        thisSpline->fd_epoch = epoch;
+        return( (theFunctions->f_easeCal)(thisSpline, p_move_percent, theFunctions, p_SMS) );
     }
 
-    // multiply the error by the FLOAT_TOLERANCE in order to get rid of the float varaible
-    theFunctions->m_nextCycleErr = (off_time - theFunctions->m_nextOffCycles) * FLOAT_TOLERANCE;
+    om_fdiff_t speed = thisSpline->fd_speed;
 
-    // worry about the fact that floats and doubles CAN actually overflow an unsigned long
-    if (theFunctions->m_nextCycleErr >= FLOAT_TOLERANCE) {
-        theFunctions->m_nextCycleErr = 0.0;
-    }
-}
+    thisSpline->fd_speed += thisSpline->fd_d1;
+    thisSpline->fd_d1 += thisSpline->fd_d2;
+    thisSpline->fd_next++;
 
+#ifdef OM_MOT_FIXED_EASING
+    return( (om_ease_t) ((speed + 0x8000) >> OM_EASE_SHIFT) );
+#else
+    return(speed);
+#endif
+}
 
 /*
 
-This function changes the current SMS move length to an integer (since the motor can't move fractional steps),
-then adds the trucated decimal to motor's error value. If the error value exceeds 1, an extra step is added to the
-upcoming SMS move.
+Fits forward differences to the piece of the easing curve starting at spline
+(or shot) p_n.  The end of the piece is found by a galloping search, and the
+curve is then sampled at p_n, p_n + h and p_n + 2h, with h the largest power of
+two which keeps the samples inside the piece, so that rounding in the samples
+is divided down by h and h squared.  Leaves fd_state alone if the piece is too
+short to fit.
 
-@p_move_percent:
-    A reference to a variable of the same name in the _linearEasing or _quadEasing functions. This is how far through
-    the total program the motor is currently
+*/
 
-@p_cur_move_steps:
-    A reference to a variable of the same name in the _linearEasing or _quadEasing functions. This length, in steps,
-    of the just-calculated SMS move. This is the value that is being adjusted to an whole number and whose floating
-    point portion is added to the motor's error.
+void OMMotorFunctions::_easeFit(s_splineCal* thisSpline, unsigned long p_n, OMMotorFunctions* theFunctions, uint8_t p_SMS) {
 
-@thisSpline:
-    A pointer to the motor's current spline, passed through from either the _linearEasing or _quadEasing function.
+    unsigned long last = p_SMS ? theFunctions->m_curPlanSplines : theFunctions->m_totalSplines;
+    uint8_t piece = _easePiece(thisSpline, p_n, theFunctions, p_SMS);
 
-@theFunctions:
-    A pointer to the current motor object, passed through from either the _linearEasing or _quadEasing function..
+    unsigned long end = p_n;        // last spline known to be in the piece
+    unsigned long out = last + 1;   // first spline known not to be
+    unsigned long step = 1;
 
-*/
+    while( step <= last - end ) {
+        if( _easePiece(thisSpline, end + step, theFunctions, p_SMS) != piece ) {
+            out = end + step;
+            break;
+        }
+        end += step;
+        step <<= 1;
+    }
 
-void OMMotorFunctions::_SMSErrorCalc(const float& p_move_percent, float& p_cur_move_steps, s_splineCal *thisSpline, OMMotorFunctions *theFunctions){
+    while( out - end > 1 ) {
+        unsigned long mid = end + (out - end) / 2;
 
+        if( _easePiece(thisSpline, mid, theFunctions, p_SMS) == piece )
+            end = mid;
+        else
+            out = mid;
+    }
 
-    byte phase = 0;
+    if( end - p_n < 2 )
+        return;
 
-    // Determine the current ramping phase
-    if (p_move_percent <= thisSpline->accel_fraction)
-        phase = ACCEL;
-    else if (p_move_percent <= thisSpline->decel_start)
-        phase = CRUISE;
-    else
-        phase = DECEL;
+    uint8_t shift = 0;
 
-    // If the calculated move would be greater than the steps remaining in the current phase 
-    // (or the movement completion equals the phase's fraction), just use the current remaining as the move length
-    switch (phase){
+    while( shift < OM_EASE_FD_MAXSHIFT && (4UL << shift) <= end - p_n )
+        shift++;
 
-    case ACCEL:
-        if ((unsigned long)p_cur_move_steps >= thisSpline->accel_steps || p_move_percent == thisSpline->accel_fraction)
-            p_cur_move_steps = thisSpline->accel_steps;
-        break;
+    unsigned long h = 1UL << shift;
 
-    case CRUISE:
+    om_ease_t f0 = _easeSample(thisSpline, p_n, theFunctions, p_SMS);
+    om_ease_t f1 = _easeSample(thisSpline, p_n + h, theFunctions, p_SMS);
+    om_ease_t f2 = _easeSample(thisSpline, p_n + 2 * h, theFunctions, p_SMS);
 
-        if ((unsigned long)p_cur_move_steps > thisSpline->cruise_steps || p_move_percent == thisSpline->decel_start)
-            p_cur_move_steps = thisSpline->cruise_steps;
-        break;
+#ifdef OM_MOT_FIXED_EASING
+    om_fdiff_t d2 = (((om_fdiff_t) f2 - 2 * (om_fdiff_t) f1 + f0) * OM_EASE_ONE) >> (2 * shift);
 
-    case DECEL:
-        if ((unsigned long)p_cur_move_steps > thisSpline->decel_steps || p_move_percent == 1.0)
-            p_cur_move_steps = thisSpline->decel_steps;
-        break;
+    thisSpline->fd_d1 = ((((om_fdiff_t) f1 - f0) * OM_EASE_ONE) >> shift) - ((d2 * (om_fdiff_t) (h - 1)) >> 1);
+    thisSpline->fd_d2 = d2;
+    thisSpline->fd_speed = (om_fdiff_t) f0 * OM_EASE_ONE;
+#else
+    float hf = h;
+    float d2 = (f2 - 2.0 * f1 + f0) / (hf * hf);
 
-    }
+    thisSpline->fd_d1 = (f1 - f0) / hf - d2 * (hf - 1.0) / 2.0;
+    thisSpline->fd_d2 = d2;
+    thisSpline->fd_speed = f0;
+#endif
 
-    // Drop the floating point from the calculated steps...
-    theFunctions->m_curPlanSpd = (unsigned long)p_cur_move_steps;
-    // ...then add the dropped decimal places to the error variable..
-    theFunctions->m_curPlanErr += (p_cur_move_steps - theFunctions->m_curPlanSpd);
-    // ... and if at least 1 full step of error has accumulated, add it to the SMS move length
-    if (theFunctions->m_curPlanErr >= 1.0) {
-        theFunctions->m_curPlanErr -= 1.0;
-        theFunctions->m_curPlanSpd++;
-    }
+    thisSpline->fd_end = end;
+    thisSpline->fd_state = OM_EASE_FD_FIT;
+}
 
-    // Adjust the remaining steps in the current phase
-    switch (phase){
+ // the current easing curve, evaluated directly at spline (or shot) p_n
+om_ease_t OMMotorFunctions::_easeSample(s_splineCal* thisSpline, unsigned long p_n, OMMotorFunctions* theFunctions, uint8_t p_SMS) {
 
-    case ACCEL:
-        thisSpline->accel_steps -= theFunctions->m_curPlanSpd;
+    if( ! p_SMS )
+        return( (theFunctions->f_easeCal)(thisSpline, _easePercent(p_n, theFunctions->m_totalSplines), theFunctions, false) );
 
-        break;
+        // SMS curves are calculated from the current shot
+    unsigned long shot = theFunctions->m_curPlanSpline;
+
+    theFunctions->m_curPlanSpline = p_n;
+    om_ease_t speed = (theFunctions->f_easeCal)(thisSpline, _easePercent(p_n, theFunctions->m_curPlanSplines), theFunctions, true);
+    theFunctions->m_curPlanSpline = shot;
+
+    return(speed);
+}
+
+/*
+
+Returns which piece of the easing curve spline (or shot) p_n falls in.  The
+curve is a single polynomial within each piece, and the pieces are numbered
+in increasing order through the move.  The phase boundaries are pieces of
+their own, as the easing functions differ in which phase they place them, and
+so are the clamped ends of continuous ramps and the thirds of S-curve ramps.
+
+*/
+
+uint8_t OMMotorFunctions::_easePiece(s_splineCal* thisSpline, unsigned long p_n, OMMotorFunctions* theFunctions, uint8_t p_SMS) {
+
+    om_ease_t pct = _easePercent(p_n, p_SMS ? theFunctions->m_curPlanSplines : theFunctions->m_totalSplines);
+    uint8_t region;
+
+    if( pct < thisSpline->accel_fraction )
+        region = 0;
+    else if( pct == thisSpline->accel_fraction )
+        region = 1;
+    else if( pct < thisSpline->decel_start )
+        region = 2;
+    else if( pct == thisSpline->decel_start )
+        region = 3;
+    else
+        region = 4;
+
+        // only the ramps are divided further
+    if( region != 0 && region != 4 )
+        return(region << 3);
+
+    uint8_t scurve = theFunctions->m_easeType == OM_MOT_SCURVE;
+
+        // SMS ramps are calculated from the shot number, and are not clamped
+    if( p_SMS && ! scurve )
+        return(region << 3);
+
+    om_ease_t x;    // how far up the ramp, as used by the easing functions
+
+    if( p_SMS ) {
+        if( region == 0 )
+            x = _easePercent(p_n, thisSpline->accel_moves);
+        else
+            x = _easePercent(thisSpline->decel_moves - (p_n - thisSpline->accel_moves - thisSpline->cruise_moves) + 1, thisSpline->decel_moves);
+    }
+    else {
+#ifdef OM_MOT_FIXED_EASING
+        if( region == 0 )
+            x = _easeMul(thisSpline->fx_accel_inv, pct);
+        else
+            x = OM_EASE_ONE - _easeMul(thisSpline->fx_decel_inv, pct - thisSpline->decel_start);
+#else
+        if( region == 0 )
+            x = pct / thisSpline->accel_fraction;
+        else
+            x = 1.0 - (pct - thisSpline->accel_fraction - thisSpline->cruise_fraction) / thisSpline->decel_fraction;
+#endif
+    }
+
+    uint8_t sub;
+
+    if( x <= 0 )
+        sub = 0;
+    else if( x >= OM_EASE_ONE )
+        sub = 4;
+    else if( ! scurve )
+        sub = 2;
+    else if( x < OM_EASE_ONE / 3 )
+        sub = 1;
+    else if( x <= (OM_EASE_ONE * 2) / 3 )
+        sub = 2;
+    else
+        sub = 3;
+
+        // deceleration ramps run down the curve
+    if( region == 4 )
+        sub = 4 - sub;
+
+    return( (region << 3) | sub );
+}
+
+ // evaluate the easing curve for spline p_spline of the current continuous move
+void OMMotorFunctions::_easeSpline(unsigned long p_spline) {
+
+    m_easeSpline = p_spline;
+    f_easeFunc(false, _easePercent(p_spline, m_totalSplines), this);
+}
+
+
+/*
+
+This function modifies a motor's error values for continuous moves.
+
+@p_move_percent:
+    A reference to a variable of the same name in the _linearEasing or _quadEasing functions. This is how far through
+    the total program the motor is currently
+
+@p_cur_spd:
+    A reference to a variable of the same name in the _linearEasing or _quadEasing functions. This is the just-calculated
+    speed, in steps/second of the current continuous move.
+
+@theFunctions:
+    A pointer to the current motor object, passed through from either the _linearEasing or _quadEasing function..
+
+*/
+
+void OMMotorFunctions::_contErrorCalc(const om_ease_t& p_move_percent, om_ease_t& p_cur_spd, OMMotorFunctions *theFunctions){
+
+    OMMotorFunctions::s_splineCal *thisSpline = &theFunctions->m_splineOne;
+
+    // queued segments ramp from and to their junction speeds, rather than from
+    // and to a stop: move the easing curve's speed into that range
+#ifdef OM_MOT_FIXED_EASING
+    if (p_move_percent < thisSpline->accel_fraction && thisSpline->start_speed > 0)
+        p_cur_spd = _easeMul(p_cur_spd, thisSpline->start_scale) + thisSpline->start_speed;
+    else if (p_move_percent >= thisSpline->decel_start && thisSpline->end_speed > 0)
+        p_cur_spd = _easeMul(p_cur_spd, thisSpline->end_scale) + thisSpline->end_speed;
+
+    // _easeMul() saturates at one, and the feed may be up to two
+    if (theFunctions->m_feedOn) {
+        theFunctions->_feedLimit(OM_EASE_FLOAT(p_cur_spd));
+
+        if (theFunctions->m_feed > 1.0)
+            p_cur_spd += _easeMul(p_cur_spd, OM_EASE(theFunctions->m_feed - 1.0));
+        else
+            p_cur_spd = _easeMul(p_cur_spd, OM_EASE(theFunctions->m_feed));
+    }
+#else
+    if (p_move_percent < thisSpline->accel_fraction && thisSpline->start_speed > 0)
+        p_cur_spd = p_cur_spd * thisSpline->start_scale + thisSpline->start_speed;
+    else if (p_move_percent >= thisSpline->decel_start && thisSpline->end_speed > 0)
+        p_cur_spd = p_cur_spd * thisSpline->end_scale + thisSpline->end_speed;
+
+    if (theFunctions->m_feedOn) {
+        theFunctions->_feedLimit(p_cur_spd);
+        p_cur_spd = p_cur_spd * theFunctions->m_feed;
+    }
+#endif
+
+#ifdef OM_MOT_FIXED_EASING
+
+    // If curSpd is very small, hold off for one second worth of cycles
+    if (p_cur_spd <= 0){
+        p_cur_spd = 1;
+        theFunctions->m_nextOffCycles = 1000000;
+        theFunctions->m_nextCycleErr = 0;
+        return;
+    }
+
+    unsigned long spd = p_cur_spd;
+    unsigned long cycles = (unsigned long) theFunctions->g_cyclesPerSpline << OM_EASE_SHIFT;
+    unsigned long off_cycles = cycles / spd;
+
+    if (off_cycles < 1){
+        theFunctions->m_nextOffCycles = 1;
+        theFunctions->m_nextCycleErr = 0;
+        return;
+    }
+
+    // the remainder is the fractional off-cycle, scale it down with the speed until
+    // multiplying it by the FLOAT_TOLERANCE cannot overflow
+    unsigned long remain = cycles - off_cycles * spd;
+
+    while (remain > 0x3FFFFF) {
+        remain >>= 1;
+        spd >>= 1;
+    }
+
+    theFunctions->m_nextOffCycles = off_cycles;
+    theFunctions->m_nextCycleErr = (remain * FLOAT_TOLERANCE) / spd;
+
+#else
+    
+    float off_time = 1000000.0;     // 1 second worth of microseconds
+
+    // If curSpd is very small, set to a small number to prevent dividing by 0
+    if (p_cur_spd <= 0.000001){
+        p_cur_spd = 0.000001;
+    }
+    // Otherwise, figure out how many cycles to delay after each step
+    else {
+        off_time = theFunctions->g_cyclesPerSpline / p_cur_spd;
+    }
+
+    // we can't track fractional off-cycles, so we need to have an error rate
+    // which we can accumulate between steps
+    // no faster than one step per cycle
+    if (off_time < 1.0){
+        theFunctions->m_nextOffCycles = 1;
+        theFunctions->m_nextCycleErr = 0;
+        return;
+    }
+
+    theFunctions->m_nextOffCycles = (unsigned long)off_time;
+
+    // multiply the error by the FLOAT_TOLERANCE in order to get rid of the float varaible
+    theFunctions->m_nextCycleErr = (off_time - theFunctions->m_nextOffCycles) * FLOAT_TOLERANCE;
+
+    // worry about the fact that floats and doubles CAN actually overflow an unsigned long
+    if (theFunctions->m_nextCycleErr >= FLOAT_TOLERANCE) {
+        theFunctions->m_nextCycleErr = 0.0;
+    }
+
+#endif
+}
+
+
+/*
+
+This function changes the current SMS move length to an integer (since the motor can't move fractional steps),
+then adds the trucated decimal to motor's error value. If the error value exceeds 1, an extra step is added to the
+upcoming SMS move.
+
+@p_move_percent:
+    A reference to a variable of the same name in the _linearEasing or _quadEasing functions. This is how far through
+    the total program the motor is currently
+
+@p_cur_move_steps:
+    A reference to a variable of the same name in the _linearEasing or _quadEasing functions. This length, in steps,
+    of the just-calculated SMS move. This is the value that is being adjusted to an whole number and whose floating
+    point portion is added to the motor's error.
+
+@thisSpline:
+    A pointer to the motor's current spline, passed through from either the _linearEasing or _quadEasing function.
+
+@theFunctions:
+    A pointer to the current motor object, passed through from either the _linearEasing or _quadEasing function..
+
+*/
+
+void OMMotorFunctions::_SMSErrorCalc(const om_ease_t& p_move_percent, float& p_cur_move_steps, s_splineCal *thisSpline, OMMotorFunctions *theFunctions){
+
+
+    byte phase = 0;
+
+    // Determine the current ramping phase
+    if (p_move_percent <= thisSpline->accel_fraction)
+        phase = ACCEL;
+    else if (p_move_percent <= thisSpline->decel_start)
+        phase = CRUISE;
+    else
+        phase = DECEL;
+
+    // If the calculated move would reach the steps remaining in the current phase 
+    // (or the movement completion equals the phase's fraction), just use the current remaining as the move length.
+    // This also keeps the carried error from adding a step to a phase that has none left.
+    switch (phase){
+
+    case ACCEL:
+        if ((unsigned long)p_cur_move_steps >= thisSpline->accel_steps || p_move_percent == thisSpline->accel_fraction)
+            p_cur_move_steps = thisSpline->accel_steps;
+        break;
+
+    case CRUISE:
+
+        if ((unsigned long)p_cur_move_steps >= thisSpline->cruise_steps || p_move_percent == thisSpline->decel_start)
+            p_cur_move_steps = thisSpline->cruise_steps;
+        break;
+
+    case DECEL:
+        if ((unsigned long)p_cur_move_steps >= thisSpline->decel_steps || p_move_percent == OM_EASE_ONE)
+            p_cur_move_steps = thisSpline->decel_steps;
+        break;
+
+    }
+
+    // Drop the floating point from the calculated steps...
+    theFunctions->m_curPlanSpd = (unsigned long)p_cur_move_steps;
+    // ...then add the dropped decimal places to the error variable..
+    theFunctions->m_curPlanErr += (p_cur_move_steps - theFunctions->m_curPlanSpd);
+    // ... and if at least 1 full step of error has accumulated, add it to the SMS move length
+    if (theFunctions->m_curPlanErr >= 1.0) {
+        theFunctions->m_curPlanErr -= 1.0;
+        theFunctions->m_curPlanSpd++;
+    }
+
+    // Adjust the remaining steps in the current phase
+    switch (phase){
+
+    case ACCEL:
+        thisSpline->accel_steps -= theFunctions->m_curPlanSpd;
+
+        break;
 
     case CRUISE:
         thisSpline->cruise_steps -= theFunctions->m_curPlanSpd;
@@ -2343,30 +3651,101 @@ void OMMotorFunctions::_SMSErrorCalc(const float& p_move_percent, float& p_cur_m
 }
 
 
-float OMMotorFunctions::_qEaseCalc(OMMotorFunctions::s_splineCal* thisSpline, float p_move_percent, OMMotorFunctions* theFunctions, uint8_t p_SMS) {
-  float curSpd;
+om_ease_t OMMotorFunctions::_linCalc(OMMotorFunctions::s_splineCal* thisSpline, om_ease_t p_move_percent, OMMotorFunctions* theFunctions, uint8_t p_SMS) {
+  om_ease_t curSpd;
+
+    // SMS moves
+    if (p_SMS){
+        float smsSpd;
+
+        // Determine whether we're currently in the accel/constant/decel phase,
+        // then assign move steps / speed based the current spline within the SMS moves
+        if (p_move_percent <= thisSpline->accel_fraction) {
+            smsSpd = thisSpline->accel_coeff * theFunctions->m_curPlanSpline;
+        }
+        else if (p_move_percent < thisSpline->decel_start) {
+            smsSpd = thisSpline->top_speed;
+        }
+        else {
+            // This should count down from the total decel moves to 1.
+            // Need to add 1, otherwise each move count is off by one and the last move is 0, which causes things to come out funky. 
+            // Basically, when that happens, what should be the first decel move ends up as the final move, which is way bad.
+            smsSpd = thisSpline->decel_coeff * (thisSpline->decel_moves - (theFunctions->m_curPlanSpline - thisSpline->accel_moves - thisSpline->cruise_moves) + 1);
+        }
+
+        curSpd = OM_EASE(smsSpd);
+    }
+
+    // Continuous moves
+    else{
+        // Determine whether we're currently in the accel/constant/decel phase,
+        // then assign move steps / speed based upon current position within that phase
+#ifdef OM_MOT_FIXED_EASING
+        if (p_move_percent <= thisSpline->accel_fraction)
+            curSpd = _easeMul(thisSpline->fx_top_speed, _easeMul(thisSpline->fx_accel_inv, p_move_percent));
+        else if (p_move_percent < thisSpline->decel_start)
+            curSpd = thisSpline->fx_top_speed;
+        else
+            curSpd = thisSpline->fx_top_speed - _easeMul(thisSpline->fx_top_speed, _easeMul(thisSpline->fx_decel_inv, p_move_percent - thisSpline->decel_start));
+#else
+        if (p_move_percent <= thisSpline->accel_fraction)
+            curSpd = thisSpline->top_speed * (p_move_percent / thisSpline->accel_fraction);
+        else if (p_move_percent < thisSpline->decel_start)
+            curSpd = thisSpline->top_speed;
+        else 
+            curSpd = thisSpline->top_speed * (1.0 - ((p_move_percent - thisSpline->accel_fraction - thisSpline->cruise_fraction) / thisSpline->decel_fraction));
+#endif
+    }
+
+  return(curSpd);
+
+}
+
+om_ease_t OMMotorFunctions::_qEaseCalc(OMMotorFunctions::s_splineCal* thisSpline, om_ease_t p_move_percent, OMMotorFunctions* theFunctions, uint8_t p_SMS) {
+  om_ease_t curSpd;
 
     // For SMS moves
     if (p_SMS){
+        float x;
+        float smsSpd;
+
         // Accel phase
         if (p_move_percent < thisSpline->accel_fraction) {
-            p_move_percent = theFunctions->m_curPlanSpline;
-            curSpd = thisSpline->accel_coeff * p_move_percent * p_move_percent;     // y = ax^2, where y = curSpd, x = p_move_percent and a = steps per calculation unit
+            x = theFunctions->m_curPlanSpline;
+            smsSpd = thisSpline->accel_coeff * x * x;     // y = ax^2, where y = curSpd, x = p_move_percent and a = steps per calculation unit
         }
         // Constant phase
         else if (p_move_percent <= thisSpline->decel_start) {
-            curSpd = thisSpline->top_speed;
+            smsSpd = thisSpline->top_speed;
         } 
         // Decel phase
         else {
-            p_move_percent = (theFunctions->m_curPlanSplines - (theFunctions->m_curPlanSpline - 1));
-            curSpd = thisSpline->decel_coeff * p_move_percent * p_move_percent;
+            x = (theFunctions->m_curPlanSplines - (theFunctions->m_curPlanSpline - 1));
+            smsSpd = thisSpline->decel_coeff * x * x;
         }
 
+        curSpd = OM_EASE(smsSpd);
     } 
     
     // For continuous moves
     else {
+#ifdef OM_MOT_FIXED_EASING
+        // Accel phase
+        if (p_move_percent < thisSpline->accel_fraction) {
+            p_move_percent = _easeMul(thisSpline->fx_accel_inv, p_move_percent);
+            curSpd = _easeMul(_easeMul(thisSpline->fx_top_speed, p_move_percent), p_move_percent);
+        }
+        // Constant phase
+        else if (p_move_percent < thisSpline->decel_start) {
+            curSpd = thisSpline->fx_top_speed;
+        } 
+        // Decel phase
+        else {
+            p_move_percent = _easeMul(thisSpline->fx_decel_inv, p_move_percent - thisSpline->decel_start);
+            p_move_percent = p_move_percent < OM_EASE_ONE ? OM_EASE_ONE - p_move_percent : 0;
+            curSpd = _easeMul(_easeMul(thisSpline->fx_top_speed, p_move_percent), p_move_percent);
+        }
+#else
         // Accel phase
         if (p_move_percent < thisSpline->accel_fraction) {
             p_move_percent = p_move_percent / thisSpline->accel_fraction;
@@ -2381,35 +3760,58 @@ float OMMotorFunctions::_qEaseCalc(OMMotorFunctions::s_splineCal* thisSpline, fl
             p_move_percent = 1.0 - (p_move_percent - thisSpline->accel_fraction - thisSpline->cruise_fraction) / thisSpline->decel_fraction;
             curSpd = thisSpline->top_speed * p_move_percent * p_move_percent;
         }
+#endif
     }
 
   return(curSpd);
 
 }
 
-float OMMotorFunctions::_qInvCalc(OMMotorFunctions::s_splineCal* thisSpline, float p_move_percent, OMMotorFunctions* theFunctions, uint8_t p_SMS) {
-  float curSpd;
+om_ease_t OMMotorFunctions::_qInvCalc(OMMotorFunctions::s_splineCal* thisSpline, om_ease_t p_move_percent, OMMotorFunctions* theFunctions, uint8_t p_SMS) {
+  om_ease_t curSpd;
 
     // For SMS moves
     if (p_SMS){
+        float x;
+        float smsSpd;
+
         // Accel phase
         if (p_move_percent < thisSpline->accel_fraction) {
-            p_move_percent = theFunctions->mtpc_accel - (theFunctions->m_curPlanSpline - 1);
-            curSpd = thisSpline->top_speed - thisSpline->accel_coeff * p_move_percent * p_move_percent;
+            x = theFunctions->mtpc_accel - (theFunctions->m_curPlanSpline - 1);
+            smsSpd = thisSpline->top_speed - thisSpline->accel_coeff * x * x;
         }
         // Constant phase
         else if (p_move_percent <= thisSpline->decel_start) {
-            curSpd = thisSpline->top_speed;
+            smsSpd = thisSpline->top_speed;
         } 
         // Decel phase
         else {
-            p_move_percent = (theFunctions->m_curPlanSpline) - (theFunctions->m_curPlanSplines - theFunctions->mtpc_decel);
-            curSpd = thisSpline->top_speed - (thisSpline->decel_coeff * p_move_percent * p_move_percent);
+            x = (theFunctions->m_curPlanSpline) - (theFunctions->m_curPlanSplines - theFunctions->mtpc_decel);
+            smsSpd = thisSpline->top_speed - (thisSpline->decel_coeff * x * x);
         }
+
+        curSpd = OM_EASE(smsSpd);
     } 
     
     // For continuous moves
     else {
+#ifdef OM_MOT_FIXED_EASING
+        // Accel phase
+        if (p_move_percent < thisSpline->accel_fraction) {
+            p_move_percent = _easeMul(thisSpline->fx_accel_inv, p_move_percent);
+            p_move_percent = p_move_percent < OM_EASE_ONE ? OM_EASE_ONE - p_move_percent : 0;
+            curSpd = thisSpline->fx_top_speed - _easeMul(_easeMul(thisSpline->fx_top_speed, p_move_percent), p_move_percent);
+        }
+        // Constant phase
+        else if (p_move_percent < thisSpline->decel_start) {
+            curSpd = thisSpline->fx_top_speed;
+        } 
+        // Decel phase
+        else {
+            p_move_percent = _easeMul(thisSpline->fx_decel_inv, p_move_percent - thisSpline->decel_start);
+            curSpd = thisSpline->fx_top_speed - _easeMul(_easeMul(thisSpline->fx_top_speed, p_move_percent), p_move_percent);
+        }
+#else
         // Accel phase
         if (p_move_percent < thisSpline->accel_fraction) {
             p_move_percent = 1.0 - (p_move_percent / thisSpline->accel_fraction);
@@ -2424,6 +3826,7 @@ float OMMotorFunctions::_qInvCalc(OMMotorFunctions::s_splineCal* thisSpline, flo
             p_move_percent = (p_move_percent - thisSpline->accel_fraction - thisSpline->cruise_fraction) / thisSpline->decel_fraction;
             curSpd = thisSpline->top_speed - (thisSpline->top_speed * p_move_percent * p_move_percent);
         }
+#endif
     }
 
   return(curSpd);
@@ -2433,31 +3836,218 @@ float OMMotorFunctions::_qInvCalc(OMMotorFunctions::s_splineCal* thisSpline, flo
 
 /*
 
-    Returns the partial sum for k from 1 to n.
-    i.e. 1 + 2 + 3 + ... n
+    Jerk-limited S-curve easing. Each ramp is split into thirds: acceleration rises
+    linearly, holds, and then falls back to zero, so the speed follows two parabolas
+    joined by a straight line.
 
 */
 
-unsigned long OMMotorFunctions::_partialSum(unsigned long p_input){
-    
-    return (p_input * (p_input + 1)) / 2;
-
-}
-
-
-/*
+om_ease_t OMMotorFunctions::_sCurveCalc(OMMotorFunctions::s_splineCal* thisSpline, om_ease_t p_move_percent, OMMotorFunctions* theFunctions, uint8_t p_SMS) {
+  om_ease_t curSpd;
 
-    Returns the partial sum of squares for k^2 from 1 to n.
-    i.e. 1^2 + 2^2 + 3^2 + ... n
+    // For SMS moves
+    if (p_SMS){
+        float smsSpd;
 
-*/
+        // Accel phase
+        if (p_move_percent <= thisSpline->accel_fraction) {
+            smsSpd = thisSpline->accel_coeff * thisSpline->accel_moves *
+                     OM_EASE_FLOAT(_sCurveShape(_easePercent(theFunctions->m_curPlanSpline, thisSpline->accel_moves)));
+        }
+        // Constant phase
+        else if (p_move_percent <= thisSpline->decel_start) {
+            smsSpd = thisSpline->top_speed;
+        }
+        // Decel phase, counts down from the total decel moves to 1
+        else {
+            unsigned long x = thisSpline->decel_moves - (theFunctions->m_curPlanSpline - thisSpline->accel_moves - thisSpline->cruise_moves) + 1;
+            smsSpd = thisSpline->decel_coeff * thisSpline->decel_moves *
+                     OM_EASE_FLOAT(_sCurveShape(_easePercent(x, thisSpline->decel_moves)));
+        }
 
-unsigned long OMMotorFunctions::_partialSumOfSquares(unsigned long p_input){
+        curSpd = OM_EASE(smsSpd);
+    }
 
-    return (p_input * (p_input + 1) * (2 * p_input + 1)) / 6;
+    // For continuous moves
+    else {
+#ifdef OM_MOT_FIXED_EASING
+        // Accel phase
+        if (p_move_percent < thisSpline->accel_fraction) {
+            p_move_percent = _easeMul(thisSpline->fx_accel_inv, p_move_percent);
+            curSpd = _easeMul(thisSpline->fx_top_speed, _sCurveShape(p_move_percent));
+        }
+        // Constant phase
+        else if (p_move_percent < thisSpline->decel_start) {
+            curSpd = thisSpline->fx_top_speed;
+        }
+        // Decel phase
+        else {
+            p_move_percent = _easeMul(thisSpline->fx_decel_inv, p_move_percent - thisSpline->decel_start);
+            p_move_percent = p_move_percent < OM_EASE_ONE ? OM_EASE_ONE - p_move_percent : 0;
+            curSpd = _easeMul(thisSpline->fx_top_speed, _sCurveShape(p_move_percent));
+        }
+#else
+        // Accel phase
+        if (p_move_percent < thisSpline->accel_fraction) {
+            curSpd = thisSpline->top_speed * _sCurveShape(p_move_percent / thisSpline->accel_fraction);
+        }
+        // Constant phase
+        else if (p_move_percent < thisSpline->decel_start) {
+            curSpd = thisSpline->top_speed;
+        }
+        // Decel phase
+        else {
+            p_move_percent = 1.0 - (p_move_percent - thisSpline->accel_fraction - thisSpline->cruise_fraction) / thisSpline->decel_fraction;
+            curSpd = thisSpline->top_speed * _sCurveShape(p_move_percent);
+        }
+#endif
+    }
+
+  return(curSpd);
+
+}
+
+/*
+
+    Returns the fraction of top speed (0.0-1.0) reached at a point (0.0-1.0) through
+    an S-curve ramp:
+
+        x < 1/3          y = 9/4 x^2
+        1/3 <= x <= 2/3  y = 3/2 x - 1/4
+        x > 2/3          y = 1 - 9/4 (1 - x)^2
+
+*/
+
+om_ease_t OMMotorFunctions::_sCurveShape(om_ease_t p_x) {
+
+#ifdef OM_MOT_FIXED_EASING
+    if (p_x <= 0)
+        return(0);
+    if (p_x >= OM_EASE_ONE)
+        return(OM_EASE_ONE);
+
+    if (p_x < OM_EASE_ONE / 3)
+        return((_easeMul(p_x, p_x) * 9) >> 2);
+
+    if (p_x <= (OM_EASE_ONE * 2) / 3)
+        return(((p_x * 3) >> 1) - (OM_EASE_ONE >> 2));
+
+    p_x = OM_EASE_ONE - p_x;
+    return(OM_EASE_ONE - ((_easeMul(p_x, p_x) * 9) >> 2));
+#else
+    if (p_x <= 0.0)
+        return(0.0);
+    if (p_x >= 1.0)
+        return(1.0);
+
+    if (p_x < (1.0 / 3.0))
+        return(2.25 * p_x * p_x);
+
+    if (p_x <= (2.0 / 3.0))
+        return(1.5 * p_x - 0.25);
+
+    p_x = 1.0 - p_x;
+    return(1.0 - 2.25 * p_x * p_x);
+#endif
+
+}
+
+
+/*
+
+    Returns the partial sum for k from 1 to n.
+    i.e. 1 + 2 + 3 + ... n
+
+*/
+
+unsigned long OMMotorFunctions::_partialSum(unsigned long p_input){
+    
+    return (p_input * (p_input + 1)) / 2;
+
+}
+
+
+/*
+
+    Returns the partial sum of squares for k^2 from 1 to n.
+    i.e. 1^2 + 2^2 + 3^2 + ... n
+
+*/
+
+unsigned long OMMotorFunctions::_partialSumOfSquares(unsigned long p_input){
+
+    return (p_input * (p_input + 1) * (2 * p_input + 1)) / 6;
+
+}
+
+
+/*
+
+    Returns how far p_num is through p_den (0.0-1.0) in the easing number format.
+    In fixed-point, large values are scaled down together so that the result
+    does not overflow 32 bits.
+
+*/
+
+om_ease_t OMMotorFunctions::_easePercent(unsigned long p_num, unsigned long p_den){
+
+#ifdef OM_MOT_FIXED_EASING
+    while (p_num > 0xFFFF) {
+        p_num >>= 1;
+        p_den >>= 1;
+    }
+
+    if (p_den == 0)
+        return(0);
+
+    return (om_ease_t)((p_num << OM_EASE_SHIFT) / p_den);
+#else
+    return (float) p_num / (float) p_den;
+#endif
+
+}
+
+#ifdef OM_MOT_FIXED_EASING
+
+/*
+
+    Multiplies a positive Q16.16 value by a Q16.16 fraction no greater than 1.0,
+    using only 32-bit multiplies. Fractions of 1.0 or more return the value
+    unchanged.
+
+*/
+
+unsigned long OMMotorFunctions::_easeMul(unsigned long p_val, unsigned long p_frac){
+
+    if (p_frac >= (unsigned long) OM_EASE_ONE)
+        return p_val;
+
+    return (p_val >> OM_EASE_SHIFT) * p_frac + (((p_val & 0xFFFF) * p_frac) >> OM_EASE_SHIFT);
+
+}
+
+/*
+
+    Returns 1 / p_fraction in Q16.16, saturating for very small fractions.
+
+*/
+
+unsigned long OMMotorFunctions::_easeInverse(float p_fraction){
+
+    if (p_fraction <= 0.0)
+        return 0;
+
+    float inverse = 1.0 / p_fraction;
+
+    if (inverse >= 32767.0)
+        return 0x7FFFFFFF;
+
+    return (unsigned long) OM_EASE(inverse);
 
 }
 
+#endif
+
  /* pre-calculate spline values to optimize execution time when requesting the
     velocity at a certain point
     
@@ -2476,13 +4066,19 @@ unsigned long OMMotorFunctions::_partialSumOfSquares(unsigned long p_input){
     @p_Decel:
         SMS mode: Decel movement increments OR Continuous: Decel time in milliseconds
 
+    @p_spline:
+        Continuous: spline to prepare instead of the current move's (used for queued
+        segments), or 0
+
   */
 
-void OMMotorFunctions::_initSpline(uint8_t p_SMS, float p_Steps, unsigned long p_Travel, unsigned long p_Accel, unsigned long p_Decel) {
+void OMMotorFunctions::_initSpline(uint8_t p_SMS, float p_Steps, unsigned long p_Travel, unsigned long p_Accel, unsigned long p_Decel, s_splineCal* p_spline) {
+
+   OMMotorFunctions::s_splineCal *thisSpline = p_spline != 0 ? p_spline : &m_splineOne;
+   unsigned long totSplines = p_Travel / MS_PER_SPLINE;   // Total number of SMS moves
 
-   OMMotorFunctions::s_splineCal *thisSpline = &m_splineOne;
-   m_totalSplines = p_Travel / MS_PER_SPLINE;
-   unsigned long totSplines = m_totalSplines;   // Total number of SMS moves
+   if( p_spline == 0 )
+       m_totalSplines = totSplines;
    
    if( p_SMS == true ) {
         // work with plan parameters
@@ -2498,13 +4094,30 @@ void OMMotorFunctions::_initSpline(uint8_t p_SMS, float p_Steps, unsigned long p
    _setEasingCoeff(thisSpline);
 
    // pre-calculate values for spline interpolation
-   thisSpline->accel_fraction = (float)p_Accel / (float)p_Travel;
-   thisSpline->decel_fraction = (float)p_Decel / (float)p_Travel;
-   thisSpline->cruise_fraction = 1.0 - (thisSpline->accel_fraction + thisSpline->decel_fraction);
+   float accel_fraction = (float)p_Accel / (float)p_Travel;
+   float decel_fraction = (float)p_Decel / (float)p_Travel;
+   float cruise_fraction = 1.0 - (accel_fraction + decel_fraction);
+
+   thisSpline->accel_fraction = _easePercent(p_Accel, p_Travel);
+   thisSpline->decel_fraction = _easePercent(p_Decel, p_Travel);
+   thisSpline->cruise_fraction = OM_EASE_ONE - (thisSpline->accel_fraction + thisSpline->decel_fraction);
    thisSpline->decel_start = thisSpline->accel_fraction + thisSpline->cruise_fraction;
+
+   // SMS phases end on whole shots, so the phase boundaries are calculated exactly as the
+   // shot's percentage will be, and the two compare equal on the last shot of each phase
+   if( p_SMS == true ) {
+       thisSpline->decel_start = _easePercent(p_Travel - p_Decel, p_Travel);
+       thisSpline->cruise_fraction = thisSpline->decel_start - thisSpline->accel_fraction;
+   }
+
+   // moves start from and end at rest, unless blended by _blendSpline()
+   thisSpline->start_speed = 0;
+   thisSpline->end_speed = 0;
+   thisSpline->start_scale = OM_EASE_ONE;
+   thisSpline->end_scale = OM_EASE_ONE;
    
    // Step count that equals continuous speed * travel time (CONT_VID OR CONT_TL) OR cruise phase movement length * SMS movements (SMS)
-   float length_at_cruise = p_Steps / (thisSpline->accel_fraction / thisSpline->easing_coeff + thisSpline->cruise_fraction + thisSpline->decel_fraction / thisSpline->easing_coeff);
+   float length_at_cruise = p_Steps / (accel_fraction / thisSpline->easing_coeff + cruise_fraction + decel_fraction / thisSpline->easing_coeff);
 
     // SMS mode
     if (p_SMS == true){
@@ -2513,7 +4126,9 @@ void OMMotorFunctions::_initSpline(uint8_t p_SMS, float p_Steps, unsigned long p
         unsigned long dc_movement_units = 0;        // Total of step units required to decelerate
 
 
-        if (m_easeType == OM_MOT_LINEAR){
+        if (m_easeType == OM_MOT_LINEAR || m_easeType == OM_MOT_SCURVE){
+            // the S-curve shape is symmetric, so n * shape(x / n) sums to the same
+            // partial sum as the linear ramp
             ac_movement_units = _partialSum(p_Accel);   // Partial sum equation for 1 + 2 + 3 + ... n
             dc_movement_units = _partialSum(p_Decel);
         }
@@ -2528,22 +4143,22 @@ void OMMotorFunctions::_initSpline(uint8_t p_SMS, float p_Steps, unsigned long p
             const float QUAD_TRAVEL_COEFF = 3.0;
 
             //temporarily set travel distance as if it was OM_MOT_QUAD, this is to quantize the inverse quad function
-            thisSpline->accel_steps = (unsigned long)((length_at_cruise * thisSpline->accel_fraction) / QUAD_TRAVEL_COEFF);
-            thisSpline->decel_steps = (unsigned long)((length_at_cruise * thisSpline->decel_fraction) / QUAD_TRAVEL_COEFF);
+            thisSpline->accel_steps = (unsigned long)((length_at_cruise * accel_fraction) / QUAD_TRAVEL_COEFF);
+            thisSpline->decel_steps = (unsigned long)((length_at_cruise * decel_fraction) / QUAD_TRAVEL_COEFF);
 
             //Calculate step size difference
             thisSpline->accel_coeff = (float)thisSpline->accel_steps / ((float)ac_movement_units);
             thisSpline->decel_coeff = (float)thisSpline->decel_steps / ((float)dc_movement_units);
 
             //recalculate distance
-            thisSpline->accel_steps = (unsigned long)((length_at_cruise * thisSpline->accel_fraction) / thisSpline->easing_coeff);
-            thisSpline->decel_steps = (unsigned long)((length_at_cruise * thisSpline->decel_fraction) / thisSpline->easing_coeff);
+            thisSpline->accel_steps = (unsigned long)((length_at_cruise * accel_fraction) / thisSpline->easing_coeff);
+            thisSpline->decel_steps = (unsigned long)((length_at_cruise * decel_fraction) / thisSpline->easing_coeff);
 
         }
         else {
             //calculate distance required for each acceleration/deceleration
-            thisSpline->accel_steps = (unsigned long)((length_at_cruise * thisSpline->accel_fraction) / thisSpline->easing_coeff);
-            thisSpline->decel_steps = (unsigned long)((length_at_cruise * thisSpline->decel_fraction) / thisSpline->easing_coeff);
+            thisSpline->accel_steps = (unsigned long)((length_at_cruise * accel_fraction) / thisSpline->easing_coeff);
+            thisSpline->decel_steps = (unsigned long)((length_at_cruise * decel_fraction) / thisSpline->easing_coeff);
              //Calculate step size difference
             thisSpline->accel_coeff = (float)thisSpline->accel_steps / ((float)ac_movement_units);
             thisSpline->decel_coeff = (float)thisSpline->decel_steps / ((float)dc_movement_units);
@@ -2557,11 +4172,63 @@ void OMMotorFunctions::_initSpline(uint8_t p_SMS, float p_Steps, unsigned long p
     // Continuous mode
     else {
         thisSpline->top_speed = (length_at_cruise) / ((float)totSplines);   // steps / spline (default 20ms)
+
+#ifdef OM_MOT_FIXED_EASING
+        // pre-calculate fixed-point values so no division is needed per spline
+        thisSpline->fx_top_speed = OM_EASE(thisSpline->top_speed);
+        thisSpline->fx_accel_inv = _easeInverse(accel_fraction);
+        thisSpline->fx_decel_inv = _easeInverse(decel_fraction);
+#endif
     }
 
+    thisSpline->fd_state = OM_EASE_FD_NONE;
+
     // This is referenced by the motor validation routine in the NMX firmware
-    m_top_speed = thisSpline->top_speed;
+    if( p_spline == 0 )
+        m_top_speed = thisSpline->top_speed;
+
+}
+
+ /* re-calculate the top speed of a continuous spline prepared by _initSpline()
+    so that its acceleration ramp starts from p_Entry and its deceleration ramp
+    ends at p_Exit (both in steps / spline), while still covering p_Steps in
+    p_Travel milliseconds
+
+  */
+
+void OMMotorFunctions::_blendSpline(s_splineCal* thisSpline, float p_Steps, unsigned long p_Travel, float p_Entry, float p_Exit) {
+
+    if( p_Entry <= 0.0 && p_Exit <= 0.0 )
+        return;
+
+    float accel_fraction = OM_EASE_FLOAT(thisSpline->accel_fraction);
+    float decel_fraction = OM_EASE_FLOAT(thisSpline->decel_fraction);
+    float cruise_fraction = 1.0 - (accel_fraction + decel_fraction);
+
+    // a ramp covers its edge speed over the whole ramp, plus 1/easing_coeff of the
+    // difference between the edge and top speeds
+    float ramp = 1.0 - 1.0 / thisSpline->easing_coeff;
+    float edge_steps = (accel_fraction * p_Entry + decel_fraction * p_Exit) * ramp;
+
+    float top_speed = (p_Steps / (p_Travel / MS_PER_SPLINE) - edge_steps) /
+                      (accel_fraction / thisSpline->easing_coeff + cruise_fraction + decel_fraction / thisSpline->easing_coeff);
+
+    if( p_Entry > top_speed )
+        p_Entry = top_speed;
+    if( p_Exit > top_speed )
+        p_Exit = top_speed;
+
+    thisSpline->top_speed = top_speed;
+    thisSpline->start_speed = OM_EASE(p_Entry);
+    thisSpline->end_speed = OM_EASE(p_Exit);
+    thisSpline->start_scale = OM_EASE(1.0 - p_Entry / top_speed);
+    thisSpline->end_scale = OM_EASE(1.0 - p_Exit / top_speed);
 
+#ifdef OM_MOT_FIXED_EASING
+    thisSpline->fx_top_speed = OM_EASE(top_speed);
+#endif
+
+    thisSpline->fd_state = OM_EASE_FD_NONE;
 }
 
 void OMMotorFunctions::_setEasingCoeff(OMMotorFunctions::s_splineCal* thisSpline) {
@@ -2570,123 +4237,1692 @@ void OMMotorFunctions::_setEasingCoeff(OMMotorFunctions::s_splineCal* thisSpline
     // an acceleration period that we would travel during the same cruise period
     thisSpline->easing_coeff = 2.0; 
 
-    // for quadratic easing, we travel slightly shorter or further...
-    // note: these values can likely be tuned further
+    // for quadratic easing, we travel slightly shorter or further...
+    // note: these values can likely be tuned further
+
+    if( m_easeType == OM_MOT_QUAD )
+        thisSpline->easing_coeff = 3.0;//2.9999985;
+    else if( m_easeType == OM_MOT_QUADINV )
+        thisSpline->easing_coeff = 1.5;//1.5000597;
+
+    // S-curve easing is symmetric about the middle of the ramp, so it covers the
+    // same distance as linear easing
+}
+
+ // peak acceleration and jerk of a ramp of the current easing curve, relative
+ // to v / T and v / T^2 for a ramp to speed v taking T seconds - only the S-curve
+ // has a finite jerk (0 is returned for the others)
+void OMMotorFunctions::_rampPeaks(float* p_Accel, float* p_Jerk) {
+
+    *p_Accel = 1.0;
+    *p_Jerk = 0.0;
+
+    if( m_easeType == OM_MOT_QUAD || m_easeType == OM_MOT_QUADINV )
+        *p_Accel = 2.0;
+    else if( m_easeType == OM_MOT_SCURVE ) {
+        *p_Accel = 1.5;
+        *p_Jerk = 4.5;
+    }
+}
+
+ /* minimum-time profile for a simple move of p_Steps, at no more than p_Speed
+    steps / second and within the maxAccel() and maxJerk() limits, for an easing
+    coefficient of p_Coeff (see _setEasingCoeff()).  Sets the total travel time and the
+    time of each ramp (in milliseconds, whole splines), with no cruise when the
+    move is too short to reach full speed.
+
+    A ramp to speed v taking T seconds peaks at an acceleration of ka * v / T
+    and a jerk of kj * v / T^2, where ka and kj depend only on the easing curve,
+    and covers v * T / easing_coeff steps.  The move then takes
+
+        t(v) = p_Steps / v + 2 * (1 - 1 / easing_coeff) * T(v)
+
+    with T(v) the shortest ramp allowed by the limits.  The fastest time is found
+    at one of the stationary points of t(v) under each limit, where the limit
+    which sets T(v) changes over, or at the highest usable speed.
+
+  */
+
+void OMMotorFunctions::_solveMove(float p_Steps, float p_Speed, float p_Coeff, float* p_Travel, float* p_Ramp) {
+
+    float coeff = p_Coeff;
+    float lost = 2.0 * (1.0 - 1.0 / coeff);
+    float ka;
+    float kj;
+
+    _rampPeaks(&ka, &kj);
+
+    float tA = ka / m_maxAccel;                                     // T(v) = tA * v
+    float tJ = ( kj > 0.0 && m_maxJerk > 0.0 ) ? sqrt(kj / m_maxJerk) : 0.0; // T(v) = tJ * sqrt(v)
+
+        // fastest speed for which the two ramps alone cover the move - above
+        // this the profile would need a negative cruise
+    float top = sqrt(p_Steps * coeff / (2.0 * tA));
+    if( tJ > 0.0 ) {
+        float topJ = pow(p_Steps * coeff / (2.0 * tJ), 2.0 / 3.0);
+        if( topJ < top )
+            top = topJ;
+    }
+
+    if( p_Speed < top )
+        top = p_Speed;
+
+    float cand[4];
+    uint8_t count = 0;
+
+    cand[count++] = top;
+
+    if( lost > 0.0 ) {
+        cand[count++] = sqrt(p_Steps / (tA * lost));
+        if( tJ > 0.0 )
+            cand[count++] = pow(2.0 * p_Steps / (tJ * lost), 2.0 / 3.0);
+    }
+
+    if( tJ > 0.0 )
+        cand[count++] = (tJ / tA) * (tJ / tA);
+
+    float best = 0.0;
+    float bestTm = 0.0;
+
+    for( uint8_t i = 0; i < count; i++ ) {
+        float v = cand[i] < top ? cand[i] : top;
+
+        if( v <= 0.0 )
+            continue;
+
+        float ramp = tA * v;
+        if( tJ * sqrt(v) > ramp )
+            ramp = tJ * sqrt(v);
+
+        float tm = p_Steps / v + lost * ramp;
+
+        if( best == 0.0 || tm < bestTm ) {
+            best = v;
+            bestTm = tm;
+        }
+    }
+
+    float ramp = tA * best;
+    if( tJ * sqrt(best) > ramp )
+        ramp = tJ * sqrt(best);
+
+        // the spline engine changes speed once per spline, so round the ramps
+        // up to whole splines, and slow down if the longer ramps no longer fit
+    float rampMS = ceil(ramp * 1000.0 / MS_PER_SPLINE) * MS_PER_SPLINE;
+
+    if( rampMS < MS_PER_SPLINE )
+        rampMS = MS_PER_SPLINE;
+
+    ramp = rampMS / 1000.0;
+
+    float fit = p_Steps * coeff / (2.0 * ramp);
+    if( fit < best )
+        best = fit;
+
+    *p_Ramp = rampMS;
+    *p_Travel = ceil((p_Steps / best + lost * ramp) * 1000.0 / MS_PER_SPLINE) * MS_PER_SPLINE;
+}
+
+
+/** getTopSpeed
+
+    Calculates the planned move variables and report back the top speed in 16th microsteps / second that will be used during the move when
+    in time lapse continuous or video continuous mode, or 16th microsteps / move during "cruising" portion of SMS mode.
+
+*/
+
+float OMMotorFunctions::getTopSpeed() {
+
+    // Don't proceed with this function if this motor is running since calling _initSpline during a move could be bad
+    // Return -1 to indicate error
+    if (m_isRun)
+        return(-1);
+
+    // Determine the length and distance required for _initSpline()
+    // compensate for any backlash
+    long dist;
+    if (m_backCheck == true)
+        dist =abs(m_stopPos - m_startPos + m_backAdj);
+    else
+        dist =abs(m_stopPos - m_startPos);
+
+    // For time lapse SMS mode
+    if (OMMotorFunctions::g_plan_type == 0) {
+
+        // Determine the total splines based upon the travel time
+        m_curPlanSplines = (unsigned long)mtpc_arrive;
+
+        // Initialize the planned move variables to calculate the m_top_speed variable
+        _initSpline(true, dist, mtpc_arrive, mtpc_accel, mtpc_decel);
+
+            // which overwrites any plan, and its schedule
+        m_planSched = false;
+
+    }
+
+    // For time lapse continuous and video continuous modes
+    else if (OMMotorFunctions::g_plan_type == 1 || OMMotorFunctions::g_plan_type == 2) {
+
+        // Initialize the planned move variables to calculate the m_top_speed variable
+        _initSpline(false, dist, mtpc_arrive, mtpc_accel, mtpc_decel);
+
+        const float MILLIS_P_SECOND = 1000.0;
+
+        // Convert to steps/spline to steps/second
+        m_top_speed *= MILLIS_P_SECOND / MS_PER_SPLINE;
+    }
+
+    // Convert to 16th steps/move (SMS) or 16th steps/second (continuous), based on current microstepping value
+    m_top_speed *= (16.0 / (float) m_curMs);
+    return(m_top_speed);
+}
+
+/** Analyze a Move
+
+ Works out what the five-argument form of move() would need to make the given
+ move, without changing the motor's settings, position or current move.  See
+ the \ref movecheck "Checking Moves" section.
+
+ The peak speed is that of the cruise, as the spline engine would run it, and
+ the peak acceleration that of the shorter ramp for the current easing curve.
+ A move is feasible when its peak speed is within both maxStepRate() and
+ maxSpeed(), and its accel and decel times fit within its travel time.  For an
+ infeasible move, p_Check->fit is the shortest travel time, in whole splines,
+ at which the same move (with the same accel and decel times) would be feasible.
+ For a feasible move it is the travel time given.
+
+ @param p_Dir
+ Direction of the move
+
+ @param p_Dist
+ Distance to travel (steps), not including backlash
+
+ @param p_Time
+ Total travel time (mS)
+
+ @param p_Accel
+ Time spent accelerating (mS)
+
+ @param p_Decel
+ Time spent decelerating (mS)
+
+ @param p_Check
+ Receives the results
+
+ @return
+ True if the move is feasible, false if not
+ */
+
+uint8_t OMMotorFunctions::analyzeMove(uint8_t p_Dir, unsigned long p_Dist, unsigned long p_Time, unsigned long p_Accel, unsigned long p_Decel, s_moveCheck* p_Check) {
+
+        // backlash is taken up by the first move after any change of direction
+    if( p_Dir != m_curDir || m_backCheck )
+        p_Dist += backlash();
+
+    float ka;
+    float kj;
+    _rampPeaks(&ka, &kj);
+
+    unsigned long ramps = p_Accel + p_Decel;
+    unsigned long shorter = p_Accel < p_Decel ? p_Accel : p_Decel;
+
+        // speed changes once per spline, so no ramp is quicker than that
+    if( shorter < MS_PER_SPLINE )
+        shorter = MS_PER_SPLINE;
+
+    p_Check->steps = p_Dist;
+    p_Check->time = p_Time;
+
+    float peak = _movePeak(p_Dist, p_Time, p_Accel, p_Decel);
+    uint8_t ok = _checkPeak(p_Check, peak, ka * peak * 1000.0 / shorter);
+
+    p_Check->fit = p_Time;
+
+    if( ok )
+        return(true);
+
+        // the cruise speed of the engine is p_Dist / (time - (accel + decel) * (1 - 1 / easing_coeff)),
+        // so start from the time which gives the highest allowed speed, then round up
+        // to a spline which meets it
+    s_splineCal cal;
+    _setEasingCoeff(&cal);
+
+    float limit = maxStepRate() > 5000 ? 5000 : maxStepRate();
+    if( m_maxSpeed < limit )
+        limit = m_maxSpeed;
+
+    float fit = (float) p_Dist * 1000.0 / limit + ramps * (1.0 - 1.0 / cal.easing_coeff);
+    unsigned long fitMS = ((unsigned long) ceil(fit / MS_PER_SPLINE)) * MS_PER_SPLINE;
+
+    if( fitMS < ramps )
+        fitMS = ramps;
+
+    if( fitMS < MS_PER_SPLINE )
+        fitMS = MS_PER_SPLINE;
+
+    while( _movePeak(p_Dist, fitMS, p_Accel, p_Decel) > limit )
+        fitMS += MS_PER_SPLINE;
+
+    p_Check->fit = fitMS;
+
+    return(false);
+}
+
+/** Analyze a Plan
+
+ Works out what an SMS plan, as created by plan() with the same arguments,
+ would need, without changing the motor's settings, position or current plan.
+ See the \ref movecheck "Checking Moves" section.
+
+ Each shot of a plan is made with the two-argument form of move(), so p_Check
+ describes the longest shot's move (the cruise shot, plus any backlash
+ take-up), solved within contSpeed(), maxAccel() and maxJerk().  p_Check->steps
+ is the whole plan's distance, including backlash.
+
+ A plan is feasible when its shots' moves stay within both maxStepRate() and
+ maxSpeed(), and its accel and decel shots fit within its total shots.  For an
+ infeasible plan, p_Check->fit is the smallest number of shots at which the
+ shots are short enough to be feasible, or 0 if no number of shots would be
+ (the ramps need a speed above maxSpeed(): lower maxAccel()).  For a feasible
+ plan it is the number of shots given.
+
+ @param p_Shots
+ Number of intervals in the plan
+
+ @param p_Dir
+ Direction of travel
+
+ @param p_Dist
+ Distance to travel (steps), not including backlash
+
+ @param p_Accel
+ Number of intervals during which acceleration occurs
+
+ @param p_Decel
+ Number of intervals during which deceleration occurs
+
+ @param p_Check
+ Receives the results
+
+ @return
+ True if the plan is feasible, false if not
+ */
+
+uint8_t OMMotorFunctions::analyzePlan(unsigned long p_Shots, uint8_t p_Dir, unsigned long p_Dist, unsigned long p_Accel, unsigned long p_Decel, s_moveCheck* p_Check) {
+
+    unsigned int back = 0;
+
+    if( p_Dir != m_curDir || m_backCheck )
+        back = backlash();
+
+    s_splineCal cal;
+    _setEasingCoeff(&cal);
+
+    float ka;
+    float kj;
+    _rampPeaks(&ka, &kj);
+
+    float lost = (1.0 - 1.0 / cal.easing_coeff);
+    unsigned long ramps = p_Accel + p_Decel;
+
+    p_Check->steps = p_Dist + back;
+
+        // too few shots for the ramps: look at the fewest shots which fit them
+    uint8_t bad = 0;
+    unsigned long shots = p_Shots;
+
+    if( shots == 0 || ramps > shots ) {
+        bad = OM_MOT_OVER_RAMPS;
+        shots = ramps > 0 ? ramps : 1;
+    }
+
+        // steps in a cruise shot, as planned by _initSpline()
+    float shot = p_Dist / (shots - ramps * lost) + back;
+    float travel;
+    float ramp;
+    float peak = _shotPeak(shot, cal.easing_coeff, &travel, &ramp);
+
+    p_Check->time = travel;
+    p_Check->fit = shots;
+
+    uint8_t ok = _checkPeak(p_Check, peak, ka * peak * 1000.0 / ramp);
+
+    p_Check->over |= bad;
+
+    if( ok )
+        return( bad == 0 );
+
+    float limit = maxStepRate() > 5000 ? 5000 : maxStepRate();
+    if( m_maxSpeed < limit )
+        limit = m_maxSpeed;
+
+        // a shot can reach a speed no higher than its ramps allow: find the
+        // longest shot whose ramps stay within the limit
+    float tA = ka / m_maxAccel;
+    float longest = limit * limit * 2.0 * tA / cal.easing_coeff;
+
+    if( kj > 0.0 && m_maxJerk > 0.0 ) {
+        float tJ = sqrt(kj / m_maxJerk);
+        float longJ = 2.0 * tJ * limit * sqrt(limit) / cal.easing_coeff;
+        if( longJ > longest )
+            longest = longJ;
+    }
+
+    p_Check->fit = 0;
+
+    if( longest <= back )
+        return(false);
+
+        // more shots make each one shorter - search for the fewest which work
+    unsigned long lo = shots;
+    unsigned long hi = (unsigned long) ceil(p_Dist / (longest - back) + ramps * lost) + 1;
+
+    while( lo + 1 < hi ) {
+        unsigned long mid = lo + (hi - lo) / 2;
+
+        if( _shotPeak(p_Dist / (mid - ramps * lost) + back, cal.easing_coeff, &travel, &ramp) > limit )
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    p_Check->fit = hi;
+
+    return(false);
+}
+
+ // peak speed (steps / second) of a five-argument move, as the spline engine
+ // would run it, or an unlimited speed if the ramps do not fit in the move
+float OMMotorFunctions::_movePeak(float p_Steps, unsigned long p_Time, unsigned long p_Accel, unsigned long p_Decel) {
+
+    if( p_Time < MS_PER_SPLINE || p_Accel + p_Decel > p_Time )
+        return(INFINITY);
+
+    s_splineCal cal;
+    _initSpline(false, p_Steps, p_Time, p_Accel, p_Decel, &cal);
+
+    return(cal.top_speed * 1000.0 / MS_PER_SPLINE);
+}
+
+ // solves a simple move of p_Steps as move() would, returning its peak speed
+ // (steps / second) and setting its travel and ramp times (mS)
+float OMMotorFunctions::_shotPeak(float p_Steps, float p_Coeff, float* p_Travel, float* p_Ramp) {
+
+    float speed = abs(m_desiredContSpd);
+
+    if( speed > maxStepRate() )
+        speed = maxStepRate();
+
+    _solveMove(p_Steps, speed, p_Coeff, p_Travel, p_Ramp);
+
+    if( *p_Travel < 50.0 )
+        *p_Travel = 50.0;
+
+    return( p_Steps * 1000.0 / (*p_Travel - 2.0 * (1.0 - 1.0 / p_Coeff) * *p_Ramp) );
+}
+
+ // fills in the speed-related results of an analysis, returns true if the
+ // peak speed is within the stepping rate and maxSpeed()
+uint8_t OMMotorFunctions::_checkPeak(s_moveCheck* p_Check, float p_Speed, float p_Accel) {
+
+    static const unsigned int rates[] = { 1000, 2000, 4000, 5000 };
+
+    p_Check->peak_speed = p_Speed;
+    p_Check->peak_accel = p_Accel;
+    p_Check->isr_rate = 0;
+    p_Check->over = 0;
+
+    for( uint8_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++ ) {
+        if( p_Speed <= rates[i] ) {
+            p_Check->isr_rate = rates[i];
+            break;
+        }
+    }
+
+    if( isinf(p_Speed) )
+        p_Check->over |= OM_MOT_OVER_RAMPS;
+    else if( p_Speed > maxStepRate() || p_Speed > 5000.0 )
+        p_Check->over |= OM_MOT_OVER_RATE;
+
+    if( p_Speed > m_maxSpeed )
+        p_Check->over |= OM_MOT_OVER_SPEED;
+
+    return( p_Check->over == 0 );
+}
+
+/** checkRefresh
+
+Check to see if the ISR variables need to be reset and if so resets them
+
+*/
+
+void OMMotorFunctions::checkRefresh(){
+
+      if( m_refresh ) {
+          m_cyclesLow = 0;
+          m_stepsTaken = 0;
+          m_limitLeft = 0;
+          m_totalCyclesTaken = 0;
+          m_cycleErrAccumulated = 0;
+          m_usLow = 0;
+          m_usSpline = 0;
+          m_usErrAccumulated = 0;
+          m_stepPeriod = 0;
+          m_refresh = false;
+      }
+}
+
+
+void OMMotorFunctions::updateSpline(){
+
+    OM_MOT_PROFILE_SCOPE(this, OM_MOT_PROF_SPLINE);
+
+    poll();
+
+        // a retargeted move which had to stop comes back to its target
+    if (m_retarget && ! running()) {
+        m_retarget = false;
+        moveTo(m_retargetPos);
+    }
+
+#ifdef OM_MOT_SEGMENTS
+        // start or prepare the next queued segment
+    if (m_segQueue != 0) {
+        if (! running())
+            _startSegment();
+        else
+            _prepareSegment();
+    }
+#endif
+
+#ifdef OM_MOT_STEP_TABLE
+        // when driven from a step table, just keep the table filled - unless
+        // it has just been given up, when the next spline is handed over
+    if (m_tblActive) {
+        _fillStepTable();
+
+        if (m_tblActive)
+            return;
+    }
+#endif
+    
+    _publishSpline();
+}
+
+ // calculate the next spline and hand it to the stepping cycle, if the last
+ // one handed over has been consumed
+void OMMotorFunctions::_publishSpline(){
+
+    if (m_splineGen != m_splineUsed)
+        return;
+
+    m_splineBusy = true;
+
+    uint8_t epoch = m_splineEpoch;
+    uint8_t end = false;
+
+    OM_MOT_PREEMPT();
+
+    //If it's in continuous mode accel/decel until desired speed
+    if (continuous()){
+        _updateContSpeed();
+    } 
+    
+    //Calculate next spline while not in continous mode
+    else if (m_feedOn) {
+        end = _feedSpline(epoch);
+    }
+
+    else { 
+        if( m_curSpline >= m_totalSplines ) {
+                    // hey, look at that - we're at the end of our spline (and
+                    // we haven't finished our last step either, otherwise we
+                    // wouldn't get here...)
+
+            end = true;
+        } 
+        
+        else {
+
+            // Get new off cycle timing for the next point in the spline.
+            _easeSpline(m_curSpline + 1);
+        }
+    }
+
+        // write the buffer the stepping cycle is not reading, then hand it
+        // over by advancing the generation (a single byte write)
+    s_splineTiming* slot = &m_splineBuf[(uint8_t)(m_splineGen + 1) & 1];
+
+    slot->off_cycles = m_nextOffCycles;
+    slot->cycle_err = m_nextCycleErr;
+    slot->end = end;
+    slot->epoch = epoch;
+
+    OM_MOT_PREEMPT();
+
+    m_splineGen++;
+
+    splineReady = true;
+    m_splineBusy = false;
+}
+
+
+
+
+
+ // calculate the next spline of a move under a feed rate override: the move's
+ // own time advances by the override factor each spline, and the curve's speed
+ // there is scaled by the same factor (in _contErrorCalc()).  Returns true when
+ // the end of the move has been reached
+uint8_t OMMotorFunctions::_feedSpline(uint8_t p_epoch) {
+
+        // a new move starts from the spline the stepping cycle is on
+    if( m_feedEpoch != p_epoch ) {
+
+        if( m_feed == 1.0 && m_feedTarget == 1.0 ) {
+            m_feedOn = false;
+            if( m_curSpline >= m_totalSplines )
+                return(true);
+            _easeSpline(m_curSpline + 1);
+            return(false);
+        }
+
+        m_feedEpoch = p_epoch;
+        m_feedPos = m_curSpline;
+    }
+
+    if( m_feedPos >= m_totalSplines )
+        return(true);
+
+    if( m_feed < m_feedTarget ) {
+        m_feed += OM_MOT_FEED_SLEW;
+        if( m_feed > m_feedTarget )
+            m_feed = m_feedTarget;
+    }
+    else if( m_feed > m_feedTarget ) {
+        m_feed -= OM_MOT_FEED_SLEW;
+        if( m_feed < m_feedTarget )
+            m_feed = m_feedTarget;
+    }
+
+    float feed = m_feed;
+    m_feedPos += m_feed;
+
+    float pos = m_feedPos < m_totalSplines ? m_feedPos : m_totalSplines;
+
+        // not a whole spline, so no forward differences
+    m_easeSpline = 0;
+    f_easeFunc(false, OM_EASE(pos / m_totalSplines), this);
+
+        // the override saturated at the speed limit (see _feedLimit()), so
+        // the move's time only advances as far as its speed was raised
+    if( m_feed < feed )
+        m_feedPos -= feed - m_feed;
+
+    return(false);
+}
+
+ // lowers a feed rate override of more than 100% until it raises the given
+ // speed (steps / spline, before the override) no higher than maxSpeed() and
+ // maxStepRate().  The override never lowers a speed below that planned, and
+ // slews back up from where it was limited to once the speed allows it
+void OMMotorFunctions::_feedLimit(float p_spd) {
+
+    if( m_feed <= 1.0 || p_spd <= 0.0 )
+        return;
+
+        // one step per cycle is maxStepRate()
+    float top = m_maxSpeed * (MS_PER_SPLINE / 1000.0);
+
+    if( top > g_cyclesPerSpline )
+        top = g_cyclesPerSpline;
+
+    if( p_spd * m_feed <= top )
+        return;
+
+    m_feed = p_spd < top ? top / p_spd : 1.0;
+}
+
+
+/** Set Step Timing Table
+
+ Supplies a buffer into which the spline timings of non-continuous moves are
+ pre-calculated when each move begins.  See the \ref steptable "Step Timing Tables"
+ section for more information.
+
+ The table may not be changed while the motor is running.  Pass a null pointer
+ (or a size of less than two entries) to return to calculating each spline as
+ it is needed.  Does nothing unless OM_MOT_STEP_TABLE is defined.
+
+ @param p_table
+ A pointer to an array of s_stepTiming entries
+
+ @param p_size
+ The number of entries in the array
+
+ */
+
+void OMMotorFunctions::stepTable(s_stepTiming* p_table, uint8_t p_size) {
+
+#ifdef OM_MOT_STEP_TABLE
+    if( running() )
+        return;
+
+    m_stepTable = p_size < 2 ? 0 : p_table;
+    m_tblSize = p_size;
+    m_tblActive = false;
+    m_tblCompiled = false;
+    m_tblUnderruns = 0;
+#else
+        // every spline is calculated as it is needed
+    (void) p_table;
+    (void) p_size;
+#endif
+}
+
+/** Get Step Table Compiled Flag
+
+ Returns whether every spline of the current (or last) move fit into the step
+ timing table when the move began.
+
+ @return
+ Compiled (true) or streamed/not used (false)
+ */
+
+uint8_t OMMotorFunctions::stepTableCompiled() {
+#ifdef OM_MOT_STEP_TABLE
+    return(m_tblCompiled);
+#else
+    return(false);
+#endif
+}
+
+/** Get Step Table Underruns
+
+ Returns the number of spline boundaries at which the stepping cycle found no
+ pre-calculated entry in the step timing table since the table was last
+ set with stepTable().
+
+ @return
+ Count of table underruns
+ */
+
+unsigned int OMMotorFunctions::stepTableUnderruns() {
+#ifdef OM_MOT_STEP_TABLE
+    return(m_tblUnderruns);
+#else
+    return(0);
+#endif
+}
+
+/** Get Step Table Entry
+
+ Returns an entry from the step timing table.  When the current move is
+ compiled, entry 0 holds the timing of the second spline of the move, entry 1
+ the third, and so on.  (The first spline's timing is calculated by move()
+ itself.)
+
+ @param p_which
+ The entry to return
+
+ @return
+ The step timing entry, or an entry of all zeros if no table is set
+ */
+
+OMMotorFunctions::s_stepTiming OMMotorFunctions::stepTableEntry(uint8_t p_which) {
+
+    s_stepTiming entry = { 0, 0 };
+
+#ifdef OM_MOT_STEP_TABLE
+    if( m_stepTable != 0 && p_which < m_tblSize )
+        entry = m_stepTable[p_which];
+#else
+    (void) p_which;
+#endif
+
+    return(entry);
+}
+
+/** Get Spline Generation
+
+ Returns the number of splines handed from updateSpline() to the stepping cycle,
+ modulo 256.  See the \ref splinehandoff "Spline Handoff" section.
+
+ @return
+ Spline generation
+ */
+
+uint8_t OMMotorFunctions::splineGeneration() {
+    return(m_splineGen);
+}
+
+/** Get Missed Splines
+
+ Returns the number of spline boundaries at which the stepping cycle found that
+ updateSpline() had not yet calculated the next spline.
+
+ @return
+ Count of missed spline deadlines
+ */
+
+unsigned int OMMotorFunctions::missedSplines() {
+    return(m_splineMissed);
+}
+
+/** Set Missed Splines
+
+ Sets the count of missed spline deadlines, usually to reset it to zero.
+
+ @param p_count
+ New count
+ */
+
+void OMMotorFunctions::missedSplines(unsigned int p_count) {
+    m_splineMissed = p_count;
+}
+
+/** Set Step Trace Buffer
+
+ Supplies a buffer into which every step taken is recorded.  See the
+ \ref steptrace "Step Traces" section for the format of each entry.
+
+ The buffer may not be changed while the motor is running.  Pass a null
+ pointer (or a size of less than two entries) to stop tracing.  Setting the
+ buffer discards any entries not yet drained, and resets the count of dropped
+ entries.  Nothing is traced unless OM_MOT_STEP_TRACE is defined.
+
+ @param p_buf
+ A pointer to an array of trace entries
+
+ @param p_size
+ The number of entries in the array
+
+ */
+
+void OMMotorFunctions::stepTrace(uint16_t* p_buf, uint8_t p_size) {
+
+#ifdef OM_MOT_STEP_TRACE
+    if( running() )
+        return;
+
+    m_trace = p_size < 2 ? 0 : p_buf;
+    m_traceSize = p_size;
+    m_traceHead = 0;
+    m_traceTail = 0;
+    m_traceDropped = 0;
+#else
+    (void) p_buf;
+    (void) p_size;
+#endif
+}
+
+/** Get Trace Entries Available
+
+ Returns the number of trace entries waiting to be drained.
+
+ @return
+ Number of entries
+ */
+
+uint8_t OMMotorFunctions::traceAvailable() {
+
+#ifdef OM_MOT_STEP_TRACE
+    if( m_trace == 0 )
+        return(0);
+
+    uint8_t head = m_traceHead;
+    uint8_t tail = m_traceTail;
+
+    return( head >= tail ? head - tail : m_traceSize - tail + head );
+#else
+    return(0);
+#endif
+}
+
+/** Drain Trace Entries
+
+ Copies the oldest waiting trace entries out of the trace buffer, freeing
+ their space for new entries.
+
+ @param p_buf
+ A pointer to an array to receive the entries
+
+ @param p_max
+ The maximum number of entries to copy
+
+ @return
+ The number of entries copied
+ */
+
+uint8_t OMMotorFunctions::traceDrain(uint16_t* p_buf, uint8_t p_max) {
+
+    uint8_t count = 0;
+
+#ifdef OM_MOT_STEP_TRACE
+    if( m_trace == 0 )
+        return(0);
+
+    uint8_t tail = m_traceTail;
+
+    while( count < p_max && tail != m_traceHead ) {
+        p_buf[count++] = m_trace[tail];
+
+        tail++;
+        if( tail >= m_traceSize )
+            tail = 0;
+    }
+
+        // release the entries only after they have been read
+    m_traceTail = tail;
+#else
+    (void) p_buf;
+    (void) p_max;
+#endif
+
+    return(count);
+}
+
+/** Get Dropped Trace Entries
+
+ Returns the number of trace entries lost because the trace buffer was full.
+
+ @return
+ Count of dropped entries
+ */
+
+unsigned int OMMotorFunctions::traceDropped() {
+#ifdef OM_MOT_STEP_TRACE
+    return(m_traceDropped);
+#else
+    return(0);
+#endif
+}
+
+/** Set Trigger Table
+
+ Supplies a buffer to hold position triggers.  See the \ref postrigger
+ "Position Triggers" section for more information.
+
+ Setting the table clears any triggers already set.  Pass a null pointer (or a size
+ of zero) to stop using triggers.  Does nothing unless OM_MOT_TRIGGERS is
+ defined, so that no trigger can be added.
+
+ @param p_table
+ A pointer to an array of s_trigger entries
+
+ @param p_size
+ The number of entries in the array
+
+ */
+
+void OMMotorFunctions::triggerTable(s_trigger* p_table, uint8_t p_size) {
+
+#ifdef OM_MOT_TRIGGERS
+    uint8_t oldSREG = SREG;
+    cli();
+
+    m_trig = p_size == 0 ? 0 : p_table;
+    m_trigSize = p_size;
+    m_trigCount = 0;
+    m_trigLo = 0;
+    m_trigHi = 0;
+
+    SREG = oldSREG;
+#else
+    (void) p_table;
+    (void) p_size;
+#endif
+}
+
+/** Add Position Trigger
+
+ Sets a trigger to fire each time the motor arrives at the given position.
+ More than one trigger may be set at the same position, and more than one
+ trigger may share an id.
+
+ @param p_pos
+ Position, in steps from home
+
+ @param p_id
+ Id passed to the trigger handler when the trigger fires
+
+ @return
+ true if the trigger was set, false if the table is full or none has been supplied
+ */
+
+uint8_t OMMotorFunctions::addTrigger(long p_pos, uint8_t p_id) {
+
+#ifdef OM_MOT_TRIGGERS
+    if( m_trig == 0 || m_trigCount >= m_trigSize )
+        return(false);
+
+    uint8_t oldSREG = SREG;
+    cli();
+
+        // after any triggers already at the same position
+    uint8_t at = m_trigCount;
+
+    while( at > 0 && m_trig[at - 1].pos > p_pos ) {
+        m_trig[at] = m_trig[at - 1];
+        at--;
+    }
+
+    m_trig[at].pos = p_pos;
+    m_trig[at].id = p_id;
+    m_trigCount++;
+
+    _seekTriggers();
+
+    SREG = oldSREG;
+
+    return(true);
+#else
+    (void) p_pos;
+    (void) p_id;
+    return(false);
+#endif
+}
+
+/** Remove Position Trigger
+
+ Removes all triggers with the given id.
+
+ @param p_id
+ Id of the triggers to remove
+
+ @return
+ true if any triggers were removed, false if none had the id
+ */
+
+uint8_t OMMotorFunctions::removeTrigger(uint8_t p_id) {
+
+#ifdef OM_MOT_TRIGGERS
+    if( m_trig == 0 )
+        return(false);
+
+    uint8_t oldSREG = SREG;
+    cli();
+
+    uint8_t kept = 0;
+
+    for( uint8_t i = 0; i < m_trigCount; i++ ) {
+        if( m_trig[i].id != p_id )
+            m_trig[kept++] = m_trig[i];
+    }
+
+    uint8_t removed = kept != m_trigCount;
+
+    m_trigCount = kept;
+    _seekTriggers();
+
+    SREG = oldSREG;
+
+    return(removed);
+#else
+    (void) p_id;
+    return(false);
+#endif
+}
+
+/** Clear Position Triggers
+
+ Removes all triggers.  Triggers which have already fired are still passed
+ to the handler.
+
+ */
+
+void OMMotorFunctions::clearTriggers() {
+
+#ifdef OM_MOT_TRIGGERS
+    uint8_t oldSREG = SREG;
+    cli();
+
+    m_trigCount = 0;
+    m_trigLo = 0;
+    m_trigHi = 0;
+
+    SREG = oldSREG;
+#endif
+}
+
+/** Get Position Triggers
+
+ @return
+ Number of triggers set
+ */
+
+uint8_t OMMotorFunctions::triggers() {
+#ifdef OM_MOT_TRIGGERS
+    return(m_trigCount);
+#else
+    return(0);
+#endif
+}
+
+/** Set Trigger Handler
+
+ Sets the function to be called, from poll(), with the id of each position
+ trigger which has fired.
+
+ @param p_Func
+ A pointer to a function taking a single byte argument
+
+ */
+
+void OMMotorFunctions::setTriggerHandler( void(*p_Func)(uint8_t) ) {
+#ifdef OM_MOT_TRIGGERS
+    f_trigSignal = p_Func;
+#else
+    (void) p_Func;
+#endif
+}
+
+#ifdef OM_MOT_TRIGGERS
+
+ // fire any triggers at the position just stepped to (stepping cycle only)
+void OMMotorFunctions::_checkTriggers(int p_Steps) {
+
+    if( p_Steps > 0 ) {
+            // triggers at the last position are now below
+        uint8_t i = m_trigHi;
+
+        m_trigLo = i;
+
+        while( i < m_trigCount && m_trig[i].pos <= m_curPos )
+            _queueEvent(OM_MOT_EVT_TRIGGER, m_trig[i++].id);
+
+        m_trigHi = i;
+    }
+    else {
+            // triggers at the last position are now above
+        uint8_t i = m_trigLo;
+
+        m_trigHi = i;
+
+        while( i > 0 && m_trig[i - 1].pos >= m_curPos )
+            _queueEvent(OM_MOT_EVT_TRIGGER, m_trig[--i].id);
+
+        m_trigLo = i;
+    }
+}
+
+ // find the triggers either side of the current position, after the position
+ // or the table has changed (with the stepping cycle held off)
+void OMMotorFunctions::_seekTriggers() {
+
+    uint8_t lo = 0;
+    uint8_t hi = m_trigCount;
+
+        // first trigger at or above the current position
+    while( lo < hi ) {
+        uint8_t mid = (lo + hi) / 2;
+
+        if( m_trig[mid].pos < m_curPos )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    m_trigLo = lo;
+
+    while( hi < m_trigCount && m_trig[hi].pos == m_curPos )
+        hi++;
+
+    m_trigHi = hi;
+}
+
+#endif
+
+
+/** Get Profile Record
+
+ Returns the execution time record of one profiled function.  See the
+ \ref profiling "Profiling" section.
+
+ @param p_which
+ The function, OM_MOT_PROF_STEP, OM_MOT_PROF_SPLINE, OM_MOT_PROF_CONTSPD,
+ OM_MOT_PROF_LINEAR, OM_MOT_PROF_QUAD, OM_MOT_PROF_QUADINV, or OM_MOT_PROF_SCURVE
+
+ @return
+ The record, or a record of all zeros if OM_MOT_PROFILE is not defined
+ */
+
+OMMotorFunctions::s_profile OMMotorFunctions::profile(uint8_t p_which) {
+
+    s_profile record = { 0, 0, 0, 0 };
+
+#ifdef OM_MOT_PROFILE
+    if( p_which < OM_MOT_PROF_COUNT ) {
+        uint8_t oldSREG = SREG;
+        cli();
+        record = m_profile[p_which];
+        SREG = oldSREG;
+
+        if( record.calls == 0 )
+            record.min = 0;
+    }
+#else
+        // nothing is recorded
+    (void) p_which;
+#endif
+
+    return(record);
+}
+
+/** Get Profile Value
+
+ Returns a single value from the execution time record of one profiled
+ function, for sending over the bus.
+
+ @param p_which
+ The function, as for profile(uint8_t)
+
+ @param p_stat
+ The value, OM_MOT_PROF_CALLS, OM_MOT_PROF_MIN, OM_MOT_PROF_MAX, or OM_MOT_PROF_MEAN
+
+ @return
+ The value, in calls or clock counts
+ */
+
+unsigned long OMMotorFunctions::profile(uint8_t p_which, uint8_t p_stat) {
+
+    s_profile record = profile(p_which);
+
+    switch( p_stat ) {
+        case OM_MOT_PROF_CALLS:
+            return(record.calls);
+        case OM_MOT_PROF_MIN:
+            return(record.min);
+        case OM_MOT_PROF_MAX:
+            return(record.max);
+        case OM_MOT_PROF_MEAN:
+            return(record.calls > 0 ? record.total / record.calls : 0);
+    }
+
+    return(0);
+}
+
+/** Reset Profile Records
+
+ Clears the execution time records of all profiled functions.
+
+ */
+
+void OMMotorFunctions::profileReset() {
+
+#ifdef OM_MOT_PROFILE
+    uint8_t oldSREG = SREG;
+    cli();
+
+    for( uint8_t i = 0; i < OM_MOT_PROF_COUNT; i++ ) {
+        m_profile[i].calls = 0;
+        m_profile[i].min = 0xFFFF;
+        m_profile[i].max = 0;
+        m_profile[i].total = 0;
+    }
+
+    SREG = oldSREG;
+#endif
+}
+
+#ifdef OM_MOT_PROFILE
+
+ // add one timed call to a profile record
+void OMMotorFunctions::_profile(uint8_t p_which, unsigned long p_time) {
+
+    if( p_which >= OM_MOT_PROF_COUNT )
+        return;
+
+    unsigned int time = p_time > 0xFFFF ? 0xFFFF : p_time;
+    s_profile* record = &m_profile[p_which];
+
+        // also called from the stepping cycle
+    uint8_t oldSREG = SREG;
+    cli();
+
+    record->calls++;
+
+    if( time < record->min )
+        record->min = time;
+    if( time > record->max )
+        record->max = time;
+
+        // stop adding once the total would overflow, so the mean stays valid
+    if( record->total + time >= record->total )
+        record->total += time;
+    else
+        record->calls--;
+
+    SREG = oldSREG;
+}
+
+#endif
+
+#ifdef OM_MOT_STEP_TABLE
+
+ // start a new move using the step table, if one is set
+void OMMotorFunctions::_initStepTable() {
+
+    m_tblActive = false;
+    m_tblCompiled = false;
+
+    if( m_stepTable == 0 || continuous() || m_feedOn )
+        return;
+
+    m_tblHead = 0;
+    m_tblTail = 0;
+        // the first spline has already been calculated by move(), and the
+        // move starts with no low cycles counted
+    m_tblSpline = 2;
+    m_tblLow = m_nextOffCycles < g_cyclesPerSpline ? m_nextOffCycles : g_cyclesPerSpline;
+    m_tblActive = true;
+
+    _fillStepTable();
+
+    m_tblCompiled = m_tblActive && ( m_tblSpline > m_totalSplines );
+}
+
+ // calculate spline timings into the step table until it is full, or the move
+ // has been completely calculated.  Should a spline need more off cycles than
+ // an entry can hold, the table is given up, and the rest of the move is
+ // calculated spline by spline.
+void OMMotorFunctions::_fillStepTable() {
+
+        // the easing functions leave their results in the next spline values,
+        // so preserve those for the first spline of the move (which the
+        // stepping cycle takes before it has used up any entry)
+    unsigned long nextOff = m_nextOffCycles;
+    unsigned int nextErr = m_nextCycleErr;
+
+    while( m_tblSpline <= m_totalSplines ) {
+
+        uint8_t next = m_tblHead + 1;
+        if( next >= m_tblSize )
+            next = 0;
+
+            // one entry is always left empty, so that a full table can be
+            // told apart from an empty one
+        if( next == m_tblTail )
+            break;
+
+        _easeSpline(m_tblSpline);
+
+            // the most cycles the stepping cycle can have counted since the
+            // last step by the end of this spline.  Saturating the off cycles
+            // only changes when the next step is taken if that many can pass.
+        unsigned long low = m_tblLow + g_cyclesPerSpline;
+
+        if( m_nextOffCycles > 0xFFFF && low > 0xFFFF ) {
+            uint8_t oldSREG = SREG;
+            cli();
+            m_tblActive = false;
+            SREG = oldSREG;
+            break;
+        }
+
+        m_tblLow = m_nextOffCycles < low ? m_nextOffCycles : low;
+
+        s_stepTiming* entry = &m_stepTable[m_tblHead];
+        entry->off_cycles = m_nextOffCycles > 0xFFFF ? 0xFFFF : m_nextOffCycles;
+        entry->cycle_err = m_nextCycleErr;
+
+            // publish the entry only after it has been written
+        m_tblHead = next;
+        m_tblSpline++;
+    }
+
+    m_nextOffCycles = nextOff;
+    m_nextCycleErr = nextErr;
+}
+
+ // move to the next spline's timing from the step table (called from
+ // checkStep()).  The timing is loaded straight into the current spline, as
+ // the main loop uses the next spline values while it fills the table.
+void OMMotorFunctions::_nextTableSpline() {
+
+    if( m_curSpline >= m_totalSplines ) {
+        endOfMove = true;
+        return;
+    }
+
+        // the main loop has not kept the table filled, hold the current
+        // timing for another spline rather than calculating it here
+    if( m_tblTail == m_tblHead ) {
+        m_tblUnderruns++;
+        return;
+    }
+
+    uint8_t tail = m_tblTail;
+
+    m_curOffCycles = m_stepTable[tail].off_cycles;
+    m_curCycleErr = m_stepTable[tail].cycle_err;
+    m_curSpline++;
+
+    tail++;
+    if( tail >= m_tblSize )
+        tail = 0;
+
+    m_tblTail = tail;
+}
+
+#endif
+
+
+/** Set Segment Queue
+
+ Supplies a buffer in which moves may be queued with queueMove(), to be run
+ back-to-back without stopping between them.  See the \ref segqueue "Segment Queues"
+ section for more information.
+
+ The queue may not be changed while the motor is running.  Pass a null pointer
+ (or a size of less than two entries) to stop using a queue.  One entry of the
+ buffer is always left empty, so a buffer of four entries queues three segments.
+ Does nothing unless OM_MOT_SEGMENTS is defined, so that queueMove() always
+ fails.
+
+ @param p_queue
+ A pointer to an array of s_segment entries
+
+ @param p_size
+ The number of entries in the array
+
+ */
+
+void OMMotorFunctions::segmentQueue(s_segment* p_queue, uint8_t p_size) {
+
+#ifdef OM_MOT_SEGMENTS
+    if( running() )
+        return;
+
+    m_segQueue = p_size < 2 ? 0 : p_queue;
+    m_segSize = p_size;
+    m_segHead = 0;
+    m_segTail = 0;
+    m_segReady = false;
+#else
+    (void) p_queue;
+    (void) p_size;
+#endif
+}
+
+/** Queue Move
+
+ Adds a move to the segment queue, using the same parameters as the five-argument
+ form of move().  If the motor is not running, the move starts at the next call
+ to updateSpline(), otherwise it starts as soon as the moves queued before it
+ have completed.
+
+ If the move before it in the queue has not yet started and travels in the
+ same direction, the two moves are blended together through a common junction
+ speed instead of stopping between them.
+
+ @param p_Dir
+ The direction to move
+
+ @param p_Dist
+ The distance to move (steps)
+
+ @param p_Time
+ The total time to travel to the new position (mS)
+
+ @param p_Accel
+ The travel time spent accelerating to full speed (mS)
+
+ @param p_Decel
+ The travel time spent decelerating back to a stop (mS)
+
+ @return
+ true if the move was queued, false if there is no queue, the queue is full,
+ the motor is disabled, or the move is shorter than one spline
+
+ */
+
+uint8_t OMMotorFunctions::queueMove(uint8_t p_Dir, unsigned long p_Dist, unsigned long p_Time, unsigned long p_Accel, unsigned long p_Decel) {
+
+#ifdef OM_MOT_SEGMENTS
+    if( m_segQueue == 0 || ! enable() || p_Dist == 0 || p_Time < MS_PER_SPLINE )
+        return(false);
+
+    uint8_t head = m_segHead;
+    uint8_t next = head + 1;
+    if( next >= m_segSize )
+        next = 0;
+
+    if( next == m_segTail )
+        return(false);
+
+    s_segment* seg = &m_segQueue[head];
+
+    seg->dir = p_Dir;
+    seg->steps = p_Dist;
+    seg->time = p_Time;
+    seg->accel = p_Accel;
+    seg->decel = p_Decel;
+    seg->entry_speed = 0.0;
+    seg->exit_speed = 0.0;
+
+    uint8_t prev = (head == 0 ? m_segSize : head) - 1;
+    float junction = _junctionSpeed(&m_segQueue[prev], seg);
+
+    uint8_t oldSREG = SREG;
+    cli();
+
+        // the segment before this one can only be blended into it if it has
+        // not yet been started
+    if( m_segTail != head && junction > 0.0 ) {
+        m_segQueue[prev].exit_speed = junction;
+        seg->entry_speed = junction;
+
+            // it has to be prepared again with its new exit speed
+        if( prev == m_segTail )
+            m_segReady = false;
+    }
+
+    m_segHead = next;
+
+    SREG = oldSREG;
+
+    _prepareSegment();
+
+    return(true);
+#else
+    (void) p_Dir;
+    (void) p_Dist;
+    (void) p_Time;
+    (void) p_Accel;
+    (void) p_Decel;
+    return(false);
+#endif
+}
+
+/** Get Queued Segments
+
+ Returns the number of segments waiting in the queue, not including the
+ segment currently being executed.
+
+ @return
+ Number of queued segments
+ */
+
+uint8_t OMMotorFunctions::queued() {
+
+#ifdef OM_MOT_SEGMENTS
+    if( m_segQueue == 0 )
+        return(0);
+
+    uint8_t head = m_segHead;
+    uint8_t tail = m_segTail;
+
+    return( head >= tail ? head - tail : m_segSize - tail + head );
+#else
+    return(0);
+#endif
+}
+
+/** Clear Segment Queue
+
+ Discards all queued segments.  The segment currently being executed, if any,
+ is completed and then comes to rest.
+
+ */
+
+void OMMotorFunctions::clearQueue() {
+
+#ifdef OM_MOT_SEGMENTS
+    uint8_t oldSREG = SREG;
+    cli();
+
+    m_segReady = false;
+    m_segTail = m_segHead;
+
+    SREG = oldSREG;
+#endif
+}
+
+#ifdef OM_MOT_SEGMENTS
+
+ // calculate the spline for the segment at the tail of the queue, so that the
+ // stepping cycle can start it without any easing setup of its own
+void OMMotorFunctions::_prepareSegment() {
+
+    if( m_segReady || m_segTail == m_segHead )
+        return;
+
+    s_segment* seg = &m_segQueue[m_segTail];
+    unsigned long steps = seg->steps;
+
+        // check for backlash compensation
+    if( seg->dir != m_curDir || m_backCheck == true )
+        steps += backlash();
+
+    s_splineCal spline;
+
+    _initSpline(false, steps, seg->time, seg->accel, seg->decel, &spline);
+    _blendSpline(&spline, steps, seg->time, seg->entry_speed, seg->exit_speed);
+
+    uint8_t oldSREG = SREG;
+    cli();
+
+    m_splineNext = spline;
+    m_segSteps = steps;
+    m_segSplines = seg->time / MS_PER_SPLINE;
+    m_segReady = true;
 
-    if( m_easeType == OM_MOT_QUAD )
-        thisSpline->easing_coeff = 3.0;//2.9999985;
-    else if( m_easeType == OM_MOT_QUADINV )
-        thisSpline->easing_coeff = 1.5;//1.5000597;
+    SREG = oldSREG;
 }
 
+ // start the segment at the tail of the queue from rest (main loop only)
+void OMMotorFunctions::_startSegment() {
 
-/** getTopSpeed
+    if( m_segTail == m_segHead )
+        return;
 
-    Calculates the planned move variables and report back the top speed in 16th microsteps / second that will be used during the move when
-    in time lapse continuous or video continuous mode, or 16th microsteps / move during "cruising" portion of SMS mode.
+        // maxSteps() is known to be positive here
+    if( maxSteps() > 0 && stepsMoved() >= (unsigned long) maxSteps() ) {
+        clearQueue();
+        _fireCallback(OM_MOT_DONE);
+        return;
+    }
 
-*/
+    if( maxStepRate() > 5000 )
+       maxStepRate(5000);
 
-float OMMotorFunctions::getTopSpeed() {
+    m_segReady = false;
+    m_segQueue[m_segTail].entry_speed = 0.0;
 
-    // Don't proceed with this function if this motor is running since calling _initSpline during a move could be bad
-    // Return -1 to indicate error
-    if (m_isRun)
-        return(-1);
+    _prepareSegment();
+    _nextSegment();
 
-    // Determine the length and distance required for _initSpline()
-    // compensate for any backlash
-    long dist;
-    if (m_backCheck == true)
-        dist =abs(m_stopPos - m_startPos + m_backAdj);
-    else
-        dist =abs(m_stopPos - m_startPos);
+    _stepsAsync(dir(), m_asyncSteps);
+    _fireCallback(OM_MOT_MOVING);
+}
 
-    // For time lapse SMS mode
-    if (OMMotorFunctions::g_plan_type == 0) {
+#endif
 
-        // Determine the total splines based upon the travel time
-        m_curPlanSplines = (unsigned long)mtpc_arrive;
+ // switch the current move to the prepared segment at the tail of the queue,
+ // returns false if no segment has been prepared
+uint8_t OMMotorFunctions::_nextSegment() {
 
-        // Initialize the planned move variables to calculate the m_top_speed variable
-        _initSpline(true, dist, mtpc_arrive, mtpc_accel, mtpc_decel);
+#ifdef OM_MOT_SEGMENTS
+    if( ! m_segReady )
+        return(false);
 
-    }
+    s_segment* seg = &m_segQueue[m_segTail];
 
-    // For time lapse continuous and video continuous modes
-    else if (OMMotorFunctions::g_plan_type == 1 || OMMotorFunctions::g_plan_type == 2) {
+    dir(seg->dir);
 
-        // Initialize the planned move variables to calculate the m_top_speed variable
-        _initSpline(false, dist, mtpc_arrive, mtpc_accel, mtpc_decel);
+    if( m_backCheck == true ) {
+       if (dir() == 0)
+            m_curPos +=backlash();
+       else
+            m_curPos -=backlash();
+       m_backCheck = false;
+    }
 
-        const float MILLIS_P_SECOND = 1000.0;
+    _startSpline(&m_splineNext, m_segSplines, m_segSteps, 1);
 
-        // Convert to steps/spline to steps/second
-        m_top_speed *= MILLIS_P_SECOND / MS_PER_SPLINE;
-    }
+    uint8_t tail = m_segTail + 1;
+    if( tail >= m_segSize )
+        tail = 0;
 
-    // Convert to 16th steps/move (SMS) or 16th steps/second (continuous), based on current microstepping value
-    m_top_speed *= (16.0 / (float) m_curMs);
-    return(m_top_speed);
-}
+    m_segReady = false;
+    m_segTail = tail;
 
-/** checkRefresh
+    return(true);
+#else
+    return(false);
+#endif
+}
 
-Check to see if the ISR variables need to be reset and if so resets them
+ // make p_spline the current move, of p_Splines splines and p_Steps steps,
+ // starting on spline p_First, without stopping the motor (stepping cycle, or
+ // with interrupts disabled)
+void OMMotorFunctions::_startSpline(s_splineCal* p_spline, unsigned long p_Splines, unsigned long p_Steps, unsigned long p_First) {
 
-*/
+    m_splineOne = *p_spline;
+    m_totalSplines = p_Splines;
+    m_top_speed = m_splineOne.top_speed;
+    m_asyncSteps = p_Steps;
 
-void OMMotorFunctions::checkRefresh(){
+#ifdef OM_MOT_STEP_TABLE
+    m_tblActive = false;
+#endif
+    endOfMove = false;
+    m_stepsTaken = 0;
+    m_limitLeft = 0;
+    m_totalCyclesTaken = 0;
+    m_usSpline = 0;
+
+        // time since the last step carries over, so the new move's first
+        // step follows on at its starting speed
+    m_curSpline = p_First;
+    _easeSpline(m_curSpline);
+    m_curOffCycles = m_nextOffCycles;
+    m_curCycleErr = m_nextCycleErr;
+    _discardSplines();
+}
 
-      if( m_refresh ) {
-          m_cyclesLow = 0;
-          m_stepsTaken = 0;
-          m_totalCyclesTaken = 0;
-          m_cycleErrAccumulated = 0;
-          m_refresh = false;
-      }
+ // returns true if the step count requested for this move has been taken
+uint8_t OMMotorFunctions::_stepsDone() {
+    return( m_asyncSteps > 0 && m_stepsTaken >= m_asyncSteps );
 }
 
+#ifdef OM_MOT_SEGMENTS
 
-void OMMotorFunctions::updateSpline(){
-    
-    if (splineReady == false){
-        
-        //If it's in continuous mode accel/decel until desired speed
-        if (continuous()){
-            _updateContSpeed();
-        } 
-        
-        //Calculate next spline while not in continous mode
-        else { 
-            if( m_curSpline >= m_totalSplines ) {
-                        // hey, look at that - we're at the end of our spline (and
-                        // we haven't finished our last step either, otherwise we
-                        // wouldn't get here...)
-
-                endOfMove = true;
-            } 
-            
-            else {
-
-                // move to the next point in the current spline.
-                float move_percent = ((float)m_curSpline + 1.0) / (float)m_totalSplines;
-
-                // Get new off cycle timing for the next point in the spline.
-                // This function is a callback to either _linearEasing or _quadEasing
-                f_easeFunc(false, move_percent, this);
-
-                endOfMove = false;
-            }
-        }
-        splineReady = true;
-    }
+ // speed (steps / spline) at which one segment can run into the next: no faster
+ // than the average speed of either segment, and at rest if the direction changes
+float OMMotorFunctions::_junctionSpeed(s_segment* p_from, s_segment* p_to) {
 
+    if( p_from->dir != p_to->dir || p_from->time < MS_PER_SPLINE )
+        return(0.0);
 
+    float from_speed = (float) p_from->steps / (p_from->time / MS_PER_SPLINE);
+    float to_speed = (float) p_to->steps / (p_to->time / MS_PER_SPLINE);
 
+    return( from_speed < to_speed ? from_speed : to_speed );
 }
 
-
+#endif
 
 
 /** checkStep
@@ -2699,22 +5935,28 @@ Check to see if the motor needs to take a step
 
 uint8_t OMMotorFunctions::checkStep(){//uint8_t p_endOfMove){
 
+    OM_MOT_PROFILE_SCOPE(this, OM_MOT_PROF_STEP);
+
     if (m_firstRun == true){ //run the first time the ISR is run, this populates the variables
         m_curOffCycles = m_nextOffCycles;
         m_curCycleErr = m_nextCycleErr;
         m_totalCyclesTaken = 0;
-        splineReady = false;
+        _discardSplines();
+#ifdef OM_MOT_STEP_TRACE
+        m_traceTicks = 0;
+#endif
         m_firstRun = false;
     }
 
+#ifdef OM_MOT_STEP_TRACE
+    m_traceTicks++;
+#endif
+
 
 
     if( m_totalCyclesTaken >= g_cyclesPerSpline) {
-        if(splineReady == false && !continuous()){
-            updateSpline();
-        }
 
-        if (endOfMove){
+        if ( ! _advanceSpline() ){
 
             if( m_stepsTaken < m_asyncSteps ) {
               // we really should be taking any steps we're missing. (if asked to
@@ -2742,25 +5984,21 @@ uint8_t OMMotorFunctions::checkStep(){//uint8_t p_endOfMove){
             // everything up, and stop the timer. (we should only get here when a
             // last step had to be taken above.)
 
-          m_stepsTaken = 0;
-          m_curSpline = 0;
-          m_totalCyclesTaken = 0;
-          m_cycleErrAccumulated = 0;
-          m_cyclesLow = 0;
+          if ( ! _nextSegment() ) {
+
+              m_stepsTaken = 0;
+              m_curSpline = 0;
+              m_totalCyclesTaken = 0;
+              m_cycleErrAccumulated = 0;
+              m_cyclesLow = 0;
 
-          stop();
-          return (false);
+              _stopMove();
+              return (false);
+          }
 
         }
 
-
-        //update spline data
-        m_curOffCycles = m_nextOffCycles;
-        m_curCycleErr = m_nextCycleErr;
-        m_curSpline++;
         m_totalCyclesTaken = 0;
-        splineReady = false;
-
 
     }
 
@@ -2794,33 +6032,21 @@ uint8_t OMMotorFunctions::checkStep(){//uint8_t p_endOfMove){
 
             // if we hit the step count requested for this move,
             // or if we have hit the maximum stepping point,
-            // stop now - don't overshoot
-
-        boolean limitViolation = false;
-          
-          if ((m_endPos < 0 && ((m_curPos <= m_endPos && m_curDir == 0) || (m_curPos >= 0 && m_curDir == 1)))){
-              if (g_debug)
-                USBSerial.println("Limit violation 0");
-              limitViolation = true;
-          }
-          else if ((m_endPos > 0 && ((m_curPos >= m_endPos  && m_curDir == 1) || (m_curPos <= 0 && m_curDir == 0)) )){
-              if (g_debug)
-                USBSerial.println("Limit violation 1");
-              limitViolation = true;
-          }
-          else if ((m_asyncSteps > 0 && m_stepsTaken >= m_asyncSteps)){
-              if (g_debug)
-                USBSerial.println("Limit violation 2");
-              limitViolation = true;
-          }
+            // stop now - don't overshoot.  The limits are only
+            // checked once the steps known to be clear of them
+            // have been taken.
 
-          if (limitViolation){
+          if( m_limitLeft == 0 && _limitReached() ){
 
               m_stepsTaken = 0;
               m_cycleErrAccumulated = 0;
               m_cyclesLow = 0;
 
-              stop();
+                // queued segments are only discarded for a limit
+              if (_stepsDone())
+                  _stopMove();
+              else
+                  stop();
           } else {
 
               m_cyclesLow = 0;
@@ -2846,6 +6072,382 @@ uint8_t OMMotorFunctions::checkStep(){//uint8_t p_endOfMove){
     return(false);
 }
 
+ // move the ISR to the next spline's timing, returns false when the end of
+ // the move has been reached instead
+uint8_t OMMotorFunctions::_advanceSpline() {
+
+#ifdef OM_MOT_STEP_TABLE
+    if (m_tblActive) {
+        _nextTableSpline();
+        return(! endOfMove);
+    }
+#endif
+
+    if (endOfMove)
+        return(false);
+
+        // drop a spline calculated for a move that has since been replaced
+    if (m_splineGen != m_splineUsed && m_splineBuf[m_splineGen & 1].epoch != m_splineEpoch)
+        m_splineUsed = m_splineGen;
+
+    if (m_splineGen == m_splineUsed && !continuous()) {
+            // the main loop has missed this spline's deadline, so calculate
+            // it here - unless updateSpline() was interrupted part-way
+            // through doing so
+        m_splineMissed++;
+
+        if (! m_splineBusy)
+            _publishSpline();
+    }
+
+        // nothing new: continuous moves keep their speed, and other moves hold
+        // the current timing for one more spline
+    if (m_splineGen == m_splineUsed)
+        return(true);
+
+    uint8_t gen = m_splineGen;
+    s_splineTiming* slot = &m_splineBuf[gen & 1];
+
+    m_splineUsed = gen;
+    splineReady = false;
+
+    if (slot->end) {
+        endOfMove = true;
+        return(false);
+    }
+
+        //update spline data
+    m_curOffCycles = slot->off_cycles;
+    m_curCycleErr = slot->cycle_err;
+    m_curSpline++;
+
+    return(true);
+}
+
+ // drop any spline handed over for the previous move (stepping cycle only)
+void OMMotorFunctions::_discardSplines() {
+
+    m_splineEpoch++;
+    m_splineUsed = m_splineGen;
+    splineReady = false;
+}
+
+ // returns true if taking another step would pass a limit or the step count
+ // requested for this move
+uint8_t OMMotorFunctions::_limitViolation() {
+
+    if ((m_endPos < 0 && ((m_curPos <= m_endPos && m_curDir == 0) || (m_curPos >= 0 && m_curDir == 1)))){
+        if (g_debug)
+          _queueEvent(OM_MOT_EVT_DEBUG, 0);
+        return(true);
+    }
+    else if ((m_endPos > 0 && ((m_curPos >= m_endPos  && m_curDir == 1) || (m_curPos <= 0 && m_curDir == 0)) )){
+        if (g_debug)
+          _queueEvent(OM_MOT_EVT_DEBUG, 1);
+        return(true);
+    }
+    else if ((m_asyncSteps > 0 && m_stepsTaken >= m_asyncSteps)){
+        if (g_debug)
+          _queueEvent(OM_MOT_EVT_DEBUG, 2);
+        return(true);
+    }
+
+    return(false);
+}
+
+ // full limit check, run when the steps known to be clear of the limits have
+ // all been taken.  Moves on to the next queued segment if this one's steps are
+ // done, and returns true if the next step must not be taken - otherwise
+ // re-arms the step counter
+uint8_t OMMotorFunctions::_limitReached() {
+
+    if (_stepsDone())
+        _nextSegment();
+
+    if (_limitViolation())
+        return(true);
+
+    m_limitLeft = _limitSteps();
+    return(false);
+}
+
+ // number of steps which can be taken in the current direction before
+ // _limitViolation() needs to be checked again
+unsigned long OMMotorFunctions::_limitSteps() {
+
+    unsigned long left = 0xFFFFFFFF;
+
+    if( m_endPos != 0 ) {
+        long lo = m_endPos < 0 ? m_endPos : 0;
+        long hi = m_endPos < 0 ? 0 : m_endPos;
+        long dist = m_curDir == 1 ? hi - m_curPos : m_curPos - lo;
+
+        if( dist <= 0 )
+            return(0);
+
+        left = dist;
+    }
+
+    if( m_asyncSteps > 0 ) {
+        unsigned long togo = m_asyncSteps > m_stepsTaken ? m_asyncSteps - m_stepsTaken : 0;
+        if( togo < left )
+            left = togo;
+    }
+
+    return(left);
+}
+
+ // forces a full limit check before the next step, called whenever the
+ // position, direction, end position or step count changes other than by
+ // stepping
+void OMMotorFunctions::_recheckLimit() {
+    uint8_t oldSREG = SREG;
+    cli();
+    m_limitLeft = 0;
+    SREG = oldSREG;
+}
+
+
+/** checkStepTimed
+
+ Variable-period alternative to checkStep().  Call this method each time the
+ period last returned by stepPeriod() has elapsed, rather than at every
+ sample period.  See the \ref steptimed "Variable-Period Stepping" section.
+
+ @return
+ true if a step should be taken now, false if not
+
+ */
+
+uint8_t OMMotorFunctions::checkStepTimed() {
+
+    OM_MOT_PROFILE_SCOPE(this, OM_MOT_PROF_STEP);
+
+    const unsigned long splineUs = (unsigned long) MS_PER_SPLINE * 1000;
+    unsigned long elapsed = m_stepPeriod;
+
+    if (m_firstRun == true){ //run the first time the ISR is run, this populates the variables
+        m_curOffCycles = m_nextOffCycles;
+        m_curCycleErr = m_nextCycleErr;
+        _discardSplines();
+        m_firstRun = false;
+
+        m_usLow = 0;
+        m_usSpline = 0;
+        m_usErrAccumulated = 0;
+#ifdef OM_MOT_STEP_TRACE
+        m_traceTicks = 0;
+        m_traceUs = 0;
+#endif
+        elapsed = 0;
+        _timedTarget();
+    }
+
+#ifdef OM_MOT_STEP_TRACE
+    m_traceUs += elapsed;
+#endif
+
+    m_usLow += elapsed;
+    m_usSpline += elapsed;
+
+    if( m_usSpline >= splineUs ) {
+
+        m_usSpline -= splineUs;
+
+        if ( ! _advanceSpline() ){
+
+            if( m_stepsTaken < m_asyncSteps ) {
+                // take any steps we're missing at the end of the move, one
+                // per sample period (see checkStep())
+              m_usSpline = splineUs;
+              m_stepsTaken++;
+              _updateMotorHome(1);
+              m_stepPeriod = g_curSampleRate;
+              return(true);
+            }
+
+          if ( ! _nextSegment() ) {
+
+              m_stepsTaken = 0;
+              m_curSpline = 0;
+              m_usLow = 0;
+              m_stepPeriod = 0;
+
+              _stopMove();
+              return(false);
+          }
+        }
+
+            // speed has changed, time since the last step is kept
+        _timedTarget();
+    }
+
+    uint8_t doStep = false;
+
+    if( m_usLow >= m_usTarget ) {
+
+        if( m_limitLeft == 0 && _limitReached() ){
+            m_stepsTaken = 0;
+            m_usLow = 0;
+            m_stepPeriod = 0;
+
+            if (_stepsDone())
+                _stopMove();
+            else
+                stop();
+            return(false);
+        }
+
+        m_usLow = 0;
+        m_stepsTaken++;
+
+        _updateMotorHome(1);
+
+            // carry the fraction of a microsecond lost from this step's period
+        m_usErrAccumulated = ((unsigned long) m_curCycleErr * g_curSampleRate + m_usErrAccumulated) % FLOAT_TOLERANCE;
+        _timedTarget();
+
+        doStep = true;
+    }
+
+        // wake up for the next step, or at the next spline boundary if the
+        // speed is going to change first
+    unsigned long untilStep = m_usTarget > m_usLow ? m_usTarget - m_usLow : 0;
+    unsigned long untilSpline = splineUs - m_usSpline;
+
+    m_stepPeriod = untilStep < untilSpline ? untilStep : untilSpline;
+
+    if( m_stepPeriod < OM_MOT_MIN_PERIOD )
+        m_stepPeriod = OM_MOT_MIN_PERIOD;
+
+    return(doStep);
+}
+
+/** stepPeriod
+
+ Returns the time until checkStepTimed() must next be called.
+
+ @return
+ Period in microseconds, or 0 if the move has completed
+
+ */
+
+unsigned long OMMotorFunctions::stepPeriod() {
+    return(m_stepPeriod);
+}
+
+/** checkStepCompare
+
+ Output-compare alternative to checkStepTimed(), for stepping with the Timer1
+ output-compare hardware.  Call this method from the compare interrupt, and
+ then add compareTicks() to the compare register.  checkRefresh() is called
+ as required, and need not be called separately.  See the \ref stepcompare
+ "Output-Compare Stepping" section.
+
+ @return
+ true if the compare being loaded should raise the step pin, false if not
+
+ */
+
+uint8_t OMMotorFunctions::checkStepCompare() {
+
+    const unsigned long ahead = (unsigned long) OM_MOT_CMP_AHEAD * m_cmpClock;
+
+    if( m_firstRun == true && running() ) {
+            // the first event follows the interrupt which starts the move
+        m_cmpLeft = (unsigned long) OM_MOT_MIN_PERIOD * m_cmpClock;
+        m_cmpEval = false;
+    }
+    else if( m_cmpLeft == 0 ) {
+            // the event last loaded has been reached, and the call made for
+            // it gave the time to the next
+        if( ! running() || m_stepPeriod == 0 ) {
+            m_cmpTicks = 0;
+            return(false);
+        }
+
+        m_cmpLeft = m_stepPeriod * m_cmpClock;
+        m_cmpEval = false;
+    }
+
+        // the call for an event is made only shortly before it, so that the
+        // main loop has as long as possible to prepare the next spline
+    if( ! m_cmpEval && m_cmpLeft <= ahead ) {
+
+        if( ! running() ) {
+            m_cmpTicks = 0;
+            return(false);
+        }
+
+        checkRefresh();
+
+        m_cmpStep = checkStepTimed();
+        m_cmpEval = true;
+
+        if( ! m_cmpStep && m_stepPeriod == 0 ) {
+            m_cmpTicks = 0;
+            return(false);
+        }
+    }
+
+        // until then, wake up in time to make it
+    unsigned long ticks = m_cmpEval ? m_cmpLeft : m_cmpLeft - ahead;
+
+        // leave at least half a compare's worth for the last one
+    if( ticks > OM_MOT_CMP_MAX )
+        ticks = OM_MOT_CMP_MAX / 2 + 1;
+
+    m_cmpLeft -= ticks;
+    m_cmpTicks = ticks;
+
+    return( m_cmpLeft == 0 ? m_cmpStep : false );
+}
+
+/** compareTicks
+
+ Returns the number of timer ticks to add to the compare register, following
+ a call to checkStepCompare().
+
+ @return
+ Ticks until the next compare, or 0 if the move has completed
+ */
+
+unsigned int OMMotorFunctions::compareTicks() {
+    return(m_cmpTicks);
+}
+
+/** Set Compare Clock
+
+ Sets the rate at which Timer1 counts for checkStepCompare().  Defaults to
+ OM_MOT_CMP_CLOCK, two ticks per microsecond.
+
+ @param p_ticks
+ Timer ticks per microsecond
+
+ */
+
+void OMMotorFunctions::compareClock(uint8_t p_ticks) {
+    m_cmpClock = p_ticks > 0 ? p_ticks : 1;
+}
+
+/** Get Compare Clock
+
+ @return
+ Timer ticks per microsecond
+ */
+
+uint8_t OMMotorFunctions::compareClock() {
+    return(m_cmpClock);
+}
+
+ // convert the current off cycles and cycle error to microseconds between steps
+void OMMotorFunctions::_timedTarget() {
+
+    unsigned long errUs = (unsigned long) m_curCycleErr * g_curSampleRate + m_usErrAccumulated;
+
+    m_usTarget = m_curOffCycles * g_curSampleRate + errUs / FLOAT_TOLERANCE;
+}
+
 /**
 
 Sets the flag indicating whether the motor has backlash to be taken up before a program move
@@ -43,22 +43,143 @@ See www.openmoco.org for more information
 #define OM_MOT_LINEAR    1
 #define OM_MOT_QUAD      2
 #define OM_MOT_QUADINV   3
+#define OM_MOT_SCURVE    4
 
 #define OM_MOT_DONE_PLAN 7
 
 #define MS_PER_SPLINE    20
 
+    // Default limits for simple moves, in steps/second^2 and steps/second^3
+    // (0 = no jerk limit), see maxAccel() and maxJerk()
+#ifndef OM_MOT_DEF_ACCEL
+    #define OM_MOT_DEF_ACCEL 5000.0
+#endif
+#ifndef OM_MOT_DEF_JERK
+    #define OM_MOT_DEF_JERK  0.0
+#endif
+
+    // Feed rate override range (percent), and the most the override factor
+    // may change from one spline to the next, see feedRate()
+#define OM_MOT_FEED_MIN   10
+#define OM_MOT_FEED_MAX   200
+#ifndef OM_MOT_FEED_SLEW
+    #define OM_MOT_FEED_SLEW 0.05
+#endif
+
+    // Limits a move checked by analyzeMove() or analyzePlan() breaks
+#define OM_MOT_OVER_RATE  1
+#define OM_MOT_OVER_SPEED 2
+#define OM_MOT_OVER_RAMPS 4
+
+    // Shortest period, in microseconds, checkStepTimed() will request
+#ifndef OM_MOT_MIN_PERIOD
+    #define OM_MOT_MIN_PERIOD 20
+#endif
+
 #define FLOAT_TOLERANCE  1000
 
+    // Default timer ticks per microsecond for checkStepCompare() (16MHz, /8 prescaler)
+#ifndef OM_MOT_CMP_CLOCK
+    #define OM_MOT_CMP_CLOCK 2
+#endif
+
+    // Longest interval, in timer ticks, a single compare may be loaded with
+#define OM_MOT_CMP_MAX   0xFFFF
+
+    // How far ahead of each event, in microseconds, checkStepCompare() decides it
+#ifndef OM_MOT_CMP_AHEAD
+    #define OM_MOT_CMP_AHEAD 100
+#endif
+
 #define ACCEL 0
 #define CRUISE 1
 #define DECEL 2
 
+    // Forward differencing states of a spline, see _easeStep()
+#define OM_EASE_FD_NONE     0
+#define OM_EASE_FD_PRIMED   1
+#define OM_EASE_FD_FIT      2
+
+    // Largest sample spacing (as a power of two) used to fit forward differences
+#define OM_EASE_FD_MAXSHIFT 12
+
 #define INCH 0
 #define CM 1
 #define DEG 2
 #define STEPS 3
 
+    // Define OM_MOT_FIXED_EASING before including this header to compute
+    // continuous spline updates in Q16.16 fixed-point instead of floating
+    // point. See the \ref fixedeasing "Fixed-Point Easing" section.
+
+#ifdef OM_MOT_FIXED_EASING
+    typedef long om_ease_t;
+    typedef long long om_fdiff_t;
+    #define OM_EASE_SHIFT    16
+    #define OM_EASE_ONE      ((om_ease_t) 1 << OM_EASE_SHIFT)
+    #define OM_EASE(x)       ((om_ease_t) ((x) * (float) OM_EASE_ONE))
+    #define OM_EASE_FLOAT(x) ((float) (x) / (float) OM_EASE_ONE)
+#else
+    typedef float om_ease_t;
+    typedef float om_fdiff_t;
+    #define OM_EASE_ONE      1.0
+    #define OM_EASE(x)       ((om_ease_t) (x))
+    #define OM_EASE_FLOAT(x) ((float) (x))
+#endif
+
+    // Define OM_MOT_PROFILE before including this header to time the stepping
+    // cycle and spline calculations. See the \ref profiling "Profiling" section.
+
+    // Features which most sketches do without are only built in when their
+    // macro is defined before including this header. See the
+    // \ref optfeatures "Optional Features" section.
+
+#define OM_MOT_PROF_STEP     0
+#define OM_MOT_PROF_SPLINE   1
+#define OM_MOT_PROF_CONTSPD  2
+#define OM_MOT_PROF_LINEAR   3
+#define OM_MOT_PROF_QUAD     4
+#define OM_MOT_PROF_QUADINV  5
+#define OM_MOT_PROF_SCURVE   6
+#define OM_MOT_PROF_COUNT    7
+
+    // Step trace entries, see stepTrace()
+#define OM_MOT_TRACE_DIR     0x8000
+#define OM_MOT_TRACE_GAP     0x7FFF
+
+    // Events waiting to be passed to their handlers, see poll()
+#ifndef OM_MOT_EVENTS
+    #define OM_MOT_EVENTS        8
+#endif
+
+#define OM_MOT_EVT_SIGNAL    0
+#define OM_MOT_EVT_TRIGGER   1
+#define OM_MOT_EVT_DEBUG     2
+
+#define OM_MOT_PROF_CALLS    0
+#define OM_MOT_PROF_MIN      1
+#define OM_MOT_PROF_MAX      2
+#define OM_MOT_PROF_MEAN     3
+
+#ifdef OM_MOT_PROFILE
+        // clock read at the start and end of each timed call
+    #ifndef OM_MOT_PROFILE_CLOCK
+        #define OM_MOT_PROFILE_CLOCK() micros()
+    #endif
+
+    #define OM_MOT_PROFILE_SCOPE(mot, which) OMMotorFunctions::s_profTimer _profTimer(mot, which)
+#else
+    #define OM_MOT_PROFILE_SCOPE(mot, which)
+#endif
+
+    // Marks the points in updateSpline() at which the stepping cycle
+    // interrupting it matters most.  Does nothing unless defined before
+    // including this header - the host simulator (extras/sim) fires the
+    // stepping cycle there to test those paths.
+#ifndef OM_MOT_PREEMPT
+    #define OM_MOT_PREEMPT()
+#endif
+
 
 /**
   @page ommotion Motion Capabilities
@@ -95,20 +216,112 @@ See www.openmoco.org for more information
   concerning yourself with acceleration, deceleration, or easing.  In this case,
   a two-argument form of OMMotorFunctions::move() is provided which only requires you to
   define a direction and a number of steps.   When only a direction and steps
-  are provided, the class uses the linear easing algorithm
-  and moves the motor at the specified maximum speed.  In the case of simple
-  moves such as this, the acceleration and deceleration are fixed at a rate of
-  25% of the total time it takes to make the move.
-
-  For all moves, there is no error checking to see if you've specified a speed
-  or parameters for a move that cannot actually be achieved.  The maximum speed
-  of movement is controlled by OMMotorFunctions::maxStepRate() and OMMotorFunctions::maxSpeed(),
-  and not direct observation of the motor.  Therefore, it is possible to set
+  are provided, the class makes the move in the shortest time the speed,
+  acceleration and jerk limits allow, see the \ref mintime "Minimum-Time Moves"
+  section below.
+
+  Moves are not checked when they are started: a move whose speed or
+  parameters cannot actually be achieved is attempted all the same.  Use
+  OMMotorFunctions::analyzeMove() or OMMotorFunctions::analyzePlan() to check a
+  move against maxStepRate() and maxSpeed() before making it, see the \ref movecheck
+  "Checking Moves" section below.  These limits are only those configured, and
+  not direct observation of the motor.  Therefore, it is possible to set
   speeds which cannot be achieved by your specific motor.  For more information
   on how to limit the speed of your motor or control the amount of CPU time
   spent running the motor, see the \ref movespeed "Timing and Speed Controls"
   section below.
 
+  @section mintime Minimum-Time Moves
+
+  Simple moves - the two-argument form of OMMotorFunctions::move(), as used by
+  OMMotorFunctions::moveTo(), OMMotorFunctions::home() and the moves of an SMS
+  plan - have no arrival time, and are instead solved for the shortest profile
+  within three limits:
+
+   <ul>
+    <li>Speed, set by OMMotorFunctions::contSpeed() (and never more than the maximum step rate)</li>
+    <li>Acceleration, set by OMMotorFunctions::maxAccel()</li>
+    <li>Jerk, set by OMMotorFunctions::maxJerk() (S-curve easing only)</li>
+   </ul>
+
+  The limits are applied to the peak acceleration and jerk of the current easing
+  curve, so the ramps of quadratic easing are longer than those of linear easing
+  for the same limit.  Long moves accelerate to full speed, cruise and decelerate.
+  Moves too short to reach full speed accelerate straight into their deceleration,
+  at the highest speed for which both ramps fit.  With quadratic easing the
+  shortest move may cruise a little below full speed, as its long, steep ramps
+  cost more time than a slower cruise.  Ramps are rounded up to whole splines.
+
+  @section retarget Retargeting Moves
+
+  OMMotorFunctions::moveTo() may be called again while the motor is still
+  running, as often as every spline - for example from a joystick or a tracking
+  loop.  Rather than stopping and starting again, the running move is replaced
+  with a new simple move which starts from the motor's current speed and ends
+  at the new position, and the motor carries on stepping without a pause.
+  A motor still accelerating carries on along the same acceleration ramp,
+  rather than starting a new one from its current speed, so a position moved
+  a little further on every spline is followed as closely as a single move
+  to the final position would be.
+
+  If the new position lies ahead and the motor can stop before reaching it,
+  the new move accelerates, cruises or decelerates from the current speed within
+  the same speed, acceleration and jerk limits as any other simple move.  A
+  position just inside the stopping distance is still reached without turning
+  back, decelerating at up to twice OMMotorFunctions::maxAccel().  Otherwise,
+  the motor is brought to rest as quickly as the limits allow, and the next
+  call to OMMotorFunctions::updateSpline() after it stops sends it back to the
+  position - OM_MOT_DONE is not signalled in between.  A motor moving slowly
+  enough to stop within a spline is stopped at once, and the new move starts
+  from rest, again without signalling OM_MOT_DONE unless it has stopped on
+  the new position.  Calling moveTo() with the position the motor is already
+  headed for changes nothing, so a master may repeat the same target freely.
+
+  Retargeting discards any queued segments (see \ref segqueue "Segment Queues"),
+  and does not apply to continuous motion.
+
+  @section movecheck Checking Moves
+
+  OMMotorFunctions::analyzeMove() and OMMotorFunctions::analyzePlan() work out,
+  without changing anything about the motor or the current move, what a move or
+  SMS plan would require: its peak speed and acceleration, the steps it takes
+  including backlash, and the stepping rate needed to run it.  They report
+  whether the move breaks the maxStepRate() or maxSpeed() limits, or has ramps
+  longer than the move itself, and suggest the nearest travel time (or number
+  of shots) which would not.  A master can check a whole program this way before
+  starting, rather than finding out part of the way through a shoot.
+
+  @code
+OMMotorFunctions::s_moveCheck check;
+
+if( ! Motor.analyzeMove(1, 20000, 8000, 2000, 2000, &check) ) {
+  USBSerial.print("Too fast, try ");
+  USBSerial.println(check.fit);
+}
+  @endcode
+
+  @section feedrate Feed Rate Override
+
+  OMMotorFunctions::feedRate() scales the speed of the current move, and of
+  every move after it, by 10% to 200% - including a move which is already under
+  way.  Timed moves are re-timed from where they are: the move follows the same
+  profile, but passes through it faster or slower, so it still arrives at the
+  same place but sooner or later than planned.  The override factor moves
+  towards a new setting by at most OM_MOT_FEED_SLEW each spline, so changing it
+  never makes the speed jump.  Continuous moves ramp to the overridden speed at
+  the contAccel() rate.  Each shot of an SMS plan still moves its planned
+  distance; only the time its move takes changes.
+
+  The override saturates at the speed limits: above 100%, it raises no speed
+  past the lower of maxSpeed() and maxStepRate(), and a speed planned above
+  that is left as planned.  A move whose speed reaches the limit passes
+  through that part of its profile at the limit, and so takes longer than the
+  override alone would make it.  Below 100%, the override always applies.
+
+  While the override is in use, the easing curve is evaluated directly at each
+  spline (see \ref fdeasing "Incremental Easing"), and no step timing table is
+  used.
+
   @section movease Easing
 
   The Motor Manager class applies easing to all moves, allowing for control over
@@ -172,6 +385,16 @@ See www.openmoco.org for more information
 
    <img src="chart_mqs.png">
 
+   Both linear and quadratic easing change the acceleration rate abruptly at the
+   start and end of every ramp, which can excite resonance in heavy payloads.  The
+   S-curve easing mode limits jerk (the rate of change of acceleration) by dividing
+   each ramp into three equal parts: acceleration rises linearly during the first
+   third, holds constant during the second, and falls back to zero in the last,
+   giving the classic seven-segment jerk-limited profile across the whole move.
+   The speed curve is symmetric about the middle of each ramp, so the distance
+   covered while ramping is the same as with linear easing, and each spline costs
+   no more to calculate than with quadratic easing.
+
    @section seteasing Setting the Easing Mode
 
    To set the type of easing applied to subsequent moves, use the OMMotorFunctions::easing()
@@ -182,9 +405,10 @@ See www.openmoco.org for more information
     <li>OM_MOT_LINEAR</li>
     <li>OM_MOT_QUAD</li>
     <li>OM_MOT_QUADINV</li>
+    <li>OM_MOT_SCURVE</li>
    </ul>
 
-   Selecting between linear, quadratic, and inverse quadratic easing.
+   Selecting between linear, quadratic, inverse quadratic, and S-curve easing.
 
    It is not possible to change the easing mode while a move is in progress,
    and you are advised to abandon any planned move before changing the easing
@@ -223,6 +447,36 @@ See www.openmoco.org for more information
 
    For more information on how to plan interleaved moves, see OMMotorFunctions::plan()
 
+   Normally, each call to planRun() evaluates the easing curve for that shot.
+   If a buffer is supplied with planSchedule(), plan() instead evaluates every
+   shot up front and stores the step count of each in the buffer, after which
+   planRun() only has to read the next count.  The time taken between shots is
+   then short and the same for every shot, and the whole plan can be checked
+   before it is started: planSteps() gives the total number of steps it will
+   take, planChecksum() a checksum of the schedule, and planVerify() reads
+   back the entire schedule to confirm it is intact.
+
+   As the error carried from shot to shot means each shot takes either the
+   whole number of steps below its exact distance or one more, the schedule is
+   stored as segments of up to 256 shots, each of which takes either a base
+   number of steps or one more.  Each segment is:
+
+   <ul>
+    <li>A header byte, whose lower seven bits are the change in base step
+        count from the last segment (-63 to 63), or -64 if the new base count
+        follows in the next four bytes (least significant first).  The top bit
+        is set if the segment has a bitmap.</li>
+    <li>A byte giving the number of shots in the segment, less one.</li>
+    <li>If any shot takes an extra step, a bitmap with one bit per shot
+        (least significant bit first) set for the shots that do.</li>
+   </ul>
+
+   A plan needs at most a little over one bit per shot, and much less for
+   any part of it taking a whole number of steps per shot.
+
+   If the schedule does not fit in the buffer, plan() falls back to evaluating
+   each shot in planRun(), which planScheduled() will report.
+
 
    @section steptiming The Stepping Cycle
 
@@ -275,6 +529,421 @@ See www.openmoco.org for more information
  in each time slice. This is why the maximum step rate is set to 5,000 steps
  per second, or once every 200uS.
 
+   @section fixedeasing Fixed-Point Easing
+
+   Nearly all of the time spent re-calculating the current speed is spent in
+   software floating point multiplication and division, as the AVR has no
+   floating point unit.  When OM_MOT_FIXED_EASING is defined before including
+   OMMotorFunctions.h (and when compiling OMMotorFunctions.cpp), the per-spline
+   calculations for continuous moves are instead performed using Q16.16
+   fixed-point integers: the move percentage, the easing curve, and the
+   off-cycle and cycle error calculation.  The reciprocals of the acceleration
+   and deceleration fractions are pre-calculated when the move is started, so
+   no floating point operations remain in the spline update.
+
+   The public move() and plan() interfaces are unchanged.  The speed at any
+   spline differs from the floating point result by no more than a few parts
+   in 65,536 of the top speed, and as the cycle error is still accumulated
+   between steps, the arrival time is unaffected.  The move percentage has
+   a resolution of 1/65,536 of the move, so spline updates in moves longer
+   than 65,536 splines (roughly 22 minutes) are grouped in pairs or more.
+
+   Planned (SMS) moves use the same Q16.16 arithmetic for their per-interval
+   steps: _initSpline() sets the phase boundaries as Q16.16 percentages of the
+   plan, taking the start of deceleration from the shot counts exactly as each
+   shot's own percentage is found, and _SMSErrorCalc() compares each shot's
+   percentage against them to end each phase on its last shot.  Only the
+   fractional step carried from one shot to the next is kept in floating
+   point.  Every plan lands on the same position as in the floating point
+   build, but a single interval is limited to 32,767 steps.
+
+   @section fdeasing Incremental Easing
+
+   Within each phase of a move (and each third of an S-curve ramp), every
+   easing curve is a polynomial of no more than second degree in the spline
+   (or shot) number.  As each spline follows on from the last, the speed is
+   therefore found by forward differencing: two additions per spline, rather
+   than evaluating the curve again.  When a move is started, a new phase is
+   entered, or a spline is evaluated out of order, the curve is evaluated
+   directly, and the differences are fitted to it again at the next spline by
+   sampling the curve at three points spread as widely across the phase as
+   possible.  In fixed-point builds the differences are held with 32
+   fractional bits so that they do not drift across long phases.
+
+   Fitting evaluates the curve several times over, so it is never done with
+   interrupts disabled.  When the main loop misses a spline's deadline and the
+   stepping cycle calculates that spline itself, the curve is evaluated
+   directly there, and the fit is left to the next spline updateSpline()
+   calculates.
+
+   @section steptable Step Timing Tables
+
+   By default, the next spline's off cycles and cycle error are calculated at each
+   spline boundary, and if the main loop has not done so via updateSpline(), the
+   calculation happens inside of the stepping cycle.  For moves whose parameters
+   are known when the move starts (the five-argument form of move(), and the
+   moves made by planRun()), the entire sequence of spline timings can instead be
+   calculated ahead of time into a table supplied with stepTable().  The stepping
+   cycle then only reads the next entry from the table, taking all easing math
+   out of the step path.
+
+   Each entry requires four bytes.  If the table is large enough to hold every
+   spline of the move, the whole move is compiled into the table when it begins
+   (see stepTableCompiled()), and its entries may be inspected with
+   stepTableEntry() before or while it is executed.  Otherwise, the table is
+   used as a ring buffer which is refilled in chunks each time updateSpline() is
+   called from the main loop.  If the stepping cycle reaches a spline boundary
+   and the next entry has not yet been calculated, the current timing is held
+   for one more spline, stretching the move, and the event is counted by
+   stepTableUnderruns().
+
+   An entry holds at most 65535 off cycles.  A longer off time is only entered
+   where no step can come due before the end of its spline either way, such as
+   the rest at the end of the move.  Should a very slow move need one anywhere
+   else, the table is given up there: the rest of the move is calculated spline
+   by spline as if no table were set, and it is not reported as compiled.
+
+   Step timing tables are only built in when OM_MOT_STEP_TABLE is defined
+   (see \ref optfeatures "Optional Features").  Without it, stepTable() does
+   nothing and every move is calculated spline by spline, so a sketch which
+   sets a table must define OM_MOT_STEP_TABLE to have it used.
+
+   @section splinehandoff Spline Handoff
+
+   Each spline's timing is calculated by updateSpline() in the main loop and
+   handed to the stepping cycle through a pair of buffers and a generation
+   count.  updateSpline() only calculates a spline once the stepping cycle has
+   consumed the last one, writes it to the buffer the stepping cycle is not
+   reading, and then advances the generation (see splineGeneration()) with a
+   single byte write.  The stepping cycle takes a spline only when the
+   generation has moved on, so it never blocks and never reads a part-written
+   timing, and no interrupts need to be disabled on either side.
+
+   If a spline boundary is reached before updateSpline() has handed over the
+   next spline, the deadline has been missed and is counted by missedSplines().
+   The stepping cycle then calculates the spline itself as before, unless it
+   has interrupted updateSpline() part-way through, in which case it holds the
+   current timing for one more spline.  Splines handed over for a move which
+   has since been replaced (by a new move, or the next queued segment) are
+   recognized and dropped.  A non-zero missed spline count indicates that the
+   main loop is not calling updateSpline() often enough for the sample rate.
+
+   @section steptrace Step Traces
+
+   To see the step train actually produced by a move, supply a buffer with
+   stepTrace().  Each step taken is then recorded by the stepping cycle as one
+   16-bit entry: the OM_MOT_TRACE_DIR bit holds the direction of the step, and
+   the remaining bits hold the number of stepping cycles (sample periods, see
+   curSamplePeriod()) since the previous step, or since the move began for its
+   first step.  checkStepTimed() records its times converted to the same units.
+   A gap of OM_MOT_TRACE_GAP cycles or more is recorded as one or more entries
+   of OM_MOT_TRACE_GAP cycles without a step, followed by the step itself.
+
+   The buffer is a ring, which may be drained with traceDrain() while the move
+   is running or after it has completed.  If it fills, further entries are lost
+   and counted by traceDropped().  Summing the cycle counts of the entries
+   gives the time of each step, from which the realized speed can be compared
+   against the planned move.  Step tracing is only built in when
+   OM_MOT_STEP_TRACE is defined (see \ref optfeatures "Optional Features"),
+   and otherwise costs the stepping cycle nothing.  Without it, stepTrace()
+   does nothing and traceAvailable() is always zero, so a sketch which traces
+   steps must define OM_MOT_STEP_TRACE.
+
+   @code
+uint16_t trace[128];
+uint16_t out[16];
+
+void setup() {
+  Motor.stepTrace(trace, 128);
+}
+
+void loop() {
+  uint8_t count = Motor.traceDrain(out, 16);
+
+  for( uint8_t i = 0; i < count; i++ ) {
+    if( (out[i] & ~OM_MOT_TRACE_DIR) == OM_MOT_TRACE_GAP )
+      continue;
+    Serial.print(out[i] & OM_MOT_TRACE_DIR ? '+' : '-');
+    Serial.println(out[i] & ~OM_MOT_TRACE_DIR);
+  }
+}
+   @endcode
+
+   @section motevents Motor Events
+
+   The handlers set with setHandler() and setTriggerHandler() are never
+   called from the stepping cycle, as whatever they do - often serial output -
+   would delay the next step.  Instead, the motor signals (OM_MOT_DONE and so
+   on), fired position triggers, and debug messages (see debugOutput()) are
+   placed on a queue of OM_MOT_EVENTS entries as they happen, and passed on,
+   in order, by poll().  poll() must be called from the main loop; it is also
+   called by updateSpline().  Should the queue fill, further events are lost,
+   and counted by eventsDropped().  A sketch which polls less often than the
+   motor can raise OM_MOT_EVENTS (by default, eight) events, for instance with
+   many closely spaced position triggers, should define a larger OM_MOT_EVENTS
+   before including this header.
+
+   A signal raised by a method called from the main loop - OM_MOT_DONE from
+   stop(), or from move() when the motor cannot move, and OM_MOT_BEGIN and
+   OM_MOT_MOVING as a move starts - is still passed to the handler before the
+   method returns, along with any events queued before it.  Only the events
+   which happen in the stepping cycle, such as OM_MOT_DONE at the end of a
+   move, wait for the next poll(), and so reach the handler up to one main
+   loop pass later than when the stepping cycle called it directly.
+
+   @section postrigger Position Triggers
+
+   Actions which must happen as the motor passes a given position, such as
+   firing the camera during a continuous move, are set as position triggers
+   in a table supplied with triggerTable().  addTrigger() enters a position
+   and an id of your choosing; the table is kept sorted by position, and the
+   stepping cycle keeps track of the triggers either side of the current
+   position, so only the next trigger in each direction is compared at each
+   step, however many are set.
+
+   When a step arrives at a trigger's position, in either direction, the
+   trigger fires: its id is queued by the stepping cycle, and passed to the
+   handler set with setTriggerHandler() at the next call to poll() (see
+   \ref motevents "Motor Events").  The handler is therefore called from the
+   main loop, and may take as long as it needs, but it may be called a little
+   after the position was reached.  Triggers stay in the table,
+   firing each time their position is reached, until removed with
+   removeTrigger() or clearTriggers().  A trigger added at the current
+   position does not fire until the motor leaves and returns to it.
+   Position triggers need OM_MOT_TRIGGERS to be defined, see
+   \ref optfeatures "Optional Features".  Without it, triggerTable() does
+   nothing and addTrigger() always returns false, so no trigger ever fires.
+
+   @code
+OMMotorFunctions::s_trigger marks[16];
+
+void setup() {
+  Motor.triggerTable(marks, 16);
+  Motor.setTriggerHandler(onTrigger);
+
+    // a frame every 500 steps
+  for( uint8_t i = 1; i <= 16; i++ )
+    Motor.addTrigger(i * 500L, i);
+}
+
+void onTrigger(uint8_t p_id) {
+  Camera.expose();
+}
+   @endcode
+
+   @section hostsim Host Simulation
+
+   The extras/sim directory holds a fake Arduino core and Timer1 which allow
+   this library to be built and run on a desktop machine in virtual time, along
+   with the OMMotorSim class and the omsim batch runner.  Moves, plans and
+   continuous moves are run to completion in a fraction of real time, and each
+   is checked for its final position, arrival time and peak speed.  See the
+   README.md in that directory for how to build and use it.
+
+   @section profiling Profiling
+
+   The execution times given above were measured by hand on one board.  To
+   measure them on your own hardware, define OM_MOT_PROFILE before including
+   OMMotorFunctions.h (and when compiling OMMotorFunctions.cpp).  Each call of the
+   following is then timed, and its call count, shortest, longest, and mean
+   times are recorded for each motor:
+
+   <ul>
+    <li>OM_MOT_PROF_STEP - checkStep() or checkStepTimed()</li>
+    <li>OM_MOT_PROF_SPLINE - updateSpline()</li>
+    <li>OM_MOT_PROF_CONTSPD - the continuous motion speed update</li>
+    <li>OM_MOT_PROF_LINEAR, OM_MOT_PROF_QUAD, OM_MOT_PROF_QUADINV, and
+        OM_MOT_PROF_SCURVE - one spline of each easing algorithm</li>
+   </ul>
+
+   Times are read from OM_MOT_PROFILE_CLOCK(), which defaults to micros() and
+   so has the 4uS resolution of micros() on a 16MHz AVR.  It may be re-defined
+   to read a free-running timer counter for finer results, in which case times
+   are in counts of that timer.  Calls of more than 65,535 counts are recorded
+   as 65,535.
+
+   Use profile() to retrieve the record for one of the above, and profileReset()
+   to start again.  The two-argument form of profile() returns a single value,
+   selected with OM_MOT_PROF_CALLS, OM_MOT_PROF_MIN, OM_MOT_PROF_MAX, or
+   OM_MOT_PROF_MEAN, as an unsigned long suitable for OMMoCoNode::response(), so
+   that the figures may be read over the bus by a command handler.  When
+   OM_MOT_PROFILE is not defined, no timing takes place and all records read
+   as zero.
+
+   @code
+     // in a node's command handler
+   case 120:
+     Node.response(true, Motor.profile(comData[0], comData[1]));
+     break;
+   @endcode
+
+   @section optfeatures Optional Features
+
+   Every OMMotorFunctions object carries the variables of every feature it
+   is built with, whether or not a sketch uses the feature.  Those which
+   most sketches do without are left out unless their macro is defined
+   before including OMMotorFunctions.h (and when compiling
+   OMMotorFunctions.cpp).  Their methods remain, so a sketch written for
+   them still compiles, but they do nothing and report nothing set.  These
+   features were built in by default before; a sketch which uses one must
+   now define its macro.
+
+   <ul>
+    <li>OM_MOT_STEP_TABLE - step timing tables, see stepTable() (15 bytes)</li>
+    <li>OM_MOT_SEGMENTS - segment queues, see segmentQueue() (108 bytes)</li>
+    <li>OM_MOT_STEP_TRACE - step traces, see stepTrace() (15 bytes)</li>
+    <li>OM_MOT_TRIGGERS - position triggers, see triggerTable() (8 bytes)</li>
+   </ul>
+
+   The sizes given are the RAM each adds to every motor on an AVR.  The
+   event queue (see \ref motevents "Motor Events") takes two bytes for each
+   of OM_MOT_EVENTS entries, and two more for an entry always left empty,
+   which may be set in the same way.
+
+   @section steptimed Variable-Period Stepping
+
+   With checkStep(), the stepping cycle runs every sample period whether or not
+   a step is due, so most interrupts do nothing and step times are quantized to
+   the sample period.  As an alternative, checkStepTimed() schedules the time to
+   the next step directly: each call returns whether to step now, and
+   stepPeriod() then gives the number of microseconds until the next call is
+   required, which should be programmed into the timer.  The interrupt only runs
+   when a step is due, or at a spline boundary when the speed is about to change,
+   so CPU use scales with the step rate rather than the sample rate.
+
+   The off cycles and cycle error calculated for each spline are converted to
+   microseconds using the sample period, which then only sets the resolution of
+   step timing.  A maximum step rate of 10,000 can therefore be used for
+   continuous moves without the CPU cost of a 100uS interrupt.
+
+   @code
+void stepISR() {
+  if( Motor.checkStepTimed() ) {
+    OM_MOT1_STPREG |= (1 << OM_MOT1_STPFLAG);
+    delayMicroseconds(2);
+    OM_MOT1_STPREG &= ~(1 << OM_MOT1_STPFLAG);
+  }
+
+  if( Motor.stepPeriod() > 0 )
+    Timer1.setPeriod(Motor.stepPeriod());
+  else
+    Timer1.stop();
+}
+   @endcode
+
+   @section stepcompare Output-Compare Stepping
+
+   When the step pin is toggled from the stepping interrupt, each step is
+   late by however long the interrupt waited to run, which varies with the
+   other interrupts (serial, camera) in use.  With checkStepCompare(), the
+   step edge is instead made by the Timer1 output-compare hardware: the
+   motor's step pin must be the timer's OC1A pin, with the timer counting
+   freely, and each compare match raises the pin at exactly the time loaded
+   into OCR1A.  The interrupt which follows only ends the pulse and loads the
+   next compare.
+
+   checkStepCompare() calls checkStepTimed() ahead of the timer, and returns
+   whether the compare now being loaded should raise the pin.  compareTicks()
+   gives the number of timer ticks to add to OCR1A, or zero once the move has
+   completed.  Each call to checkStepTimed() is made OM_MOT_CMP_AHEAD
+   microseconds (or one step, if sooner) before the time it stands for, so
+   longer periods are broken by a compare which does not raise the pin, as
+   are periods longer than OM_MOT_CMP_MAX ticks.  At high step rates there is
+   a single interrupt per step, at low rates two.  As steps are counted when
+   they are loaded, currentPos() may run one step ahead of the pin while
+   moving.
+
+   The timer is assumed to tick twice per microsecond (16MHz with a /8
+   prescaler), set compareClock() for any other rate.  The pulse lasts until
+   the interrupt has been entered, which is at least the two microseconds
+   most drivers require at 16MHz.  To start a move, load a compare shortly
+   ahead of the count and enable the compare interrupt; the first call makes
+   the first compare OM_MOT_MIN_PERIOD microseconds later.  Should the
+   interrupt ever run past the compare it has just loaded, as it may when it
+   has to calculate a spline the main loop missed, the compare is moved up to
+   the current count so that it is only late, rather than waiting for the
+   timer to wrap.
+
+   @code
+void startMove() {
+  Motor.move(true, 5000, 10000, 2000, 2000);
+
+  TCCR1A = _BV(COM1A1);           // clear OC1A on match, normal counting
+  TCCR1B = _BV(CS11);             // /8 prescaler
+  OCR1A = TCNT1 + 100;
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 |= _BV(OCIE1A);
+}
+
+ISR(TIMER1_COMPA_vect) {
+    // end any pulse the match raised, and clear on the next match...
+  TCCR1A &= ~_BV(COM1A0);
+  TCCR1C = _BV(FOC1A);
+
+    // ...unless the next match is a step
+  if( Motor.checkStepCompare() )
+    TCCR1A |= _BV(COM1A0);
+
+  if( Motor.compareTicks() == 0 ) {
+    TIMSK1 &= ~_BV(OCIE1A);
+    return;
+  }
+
+  OCR1A += Motor.compareTicks();
+
+  if( (int) (OCR1A - TCNT1) < 2 )
+    OCR1A = TCNT1 + 2;
+}
+   @endcode
+
+   @section segqueue Segment Queues
+
+   Each move() comes to rest and signals OM_MOT_DONE before the next move can
+   be started, so a path made of several legs stops between every leg.  Instead,
+   the legs may be queued as segments with queueMove(), taking the same
+   parameters as the five-argument form of move(), into a buffer supplied with
+   segmentQueue().  When a segment has taken all of its steps, the stepping
+   cycle starts the next queued segment immediately, without stopping the motor
+   or waiting for the main loop.
+
+   When a segment is queued behind another which has not yet started and which
+   moves in the same direction, the two are blended: the first decelerates only
+   to a junction speed, and the second accelerates from it.  The junction speed
+   is the lesser of the two segments' average speeds, so neither segment needs
+   a higher top speed than it would from rest, and each segment still arrives
+   after its given distance and time.  Segments which reverse direction, and
+   segments queued behind one which is already moving, meet at rest.
+
+   The calculations for the next segment are made by queueMove() and
+   updateSpline(), so updateSpline() must continue to be called from the main
+   loop while segments are queued.  When the motor is stopped, the first queued
+   segment is started by the next call to updateSpline(), so that segments
+   queued together can be blended from the first.  If a segment ends before the next one has
+   been prepared, the motor stops and updateSpline() starts the next segment
+   from rest.  stop() discards any queued segments, as does reaching a limit.
+   Queued segments are always calculated spline by spline, rather than from a
+   step timing table.  Segment queues hold a third copy of the spline
+   calculations, and so are only built in when OM_MOT_SEGMENTS is defined
+   (see \ref optfeatures "Optional Features").  Without it, segmentQueue()
+   does nothing and queueMove() always returns false, so a sketch which
+   queues segments must define OM_MOT_SEGMENTS.
+
+   @code
+OMMotorFunctions::s_segment legs[4];
+
+void setup() {
+  Motor.enable(true);
+  Motor.segmentQueue(legs, 4);
+  Motor.queueMove(1, 2000, 4000, 1000, 1000);
+  Motor.queueMove(1, 6000, 5000, 1000, 1000);
+  Motor.queueMove(0, 8000, 8000, 2000, 2000);
+}
+
+void loop() {
+  Motor.updateSpline();
+}
+   @endcode
+
    @section movespeed Timing and Speed Controls
 
    As discussed in the section \ref steptiming "The Stepping Cycle" above, there
@@ -304,7 +973,10 @@ See www.openmoco.org for more information
    Complex moves that specify all parameters are always attempted to be executed
    as requested, even if it results in a higher speed than specified by the
    maximum rate or maximum speed.  This can result in unexpected behavior from
-   the motor and one should adjust their distance or arrival time accordingly.
+   the motor, so check such a move first with OMMotorFunctions::analyzeMove()
+   (or a plan with OMMotorFunctions::analyzePlan()), which report the limits it
+   breaks and the nearest arrival time (or number of shots) which would not,
+   see \ref movecheck "Checking Moves".
 
 */
 
@@ -325,9 +997,9 @@ See www.openmoco.org for more information
   your program while a motor action is being performed.
 
   Status reporting from the Motor Manager is handled via a callback function,
-  which you may specify.  This function will be called at specified times
-  with a special code to indicate the status.  For more information on this,
-  see setHandler().
+  which you may specify.  This function will be called from poll() with a
+  special code to indicate the status.  For more information on this, see
+  setHandler().
 
   It is not possible to specify the motor control lines at this time, and the
   library will only work for other Arduino-compatible devices when they use
@@ -359,6 +1031,8 @@ void setup() {
 
 void loop() {
 
+ Motor.poll();
+
  if( ! Motor.running() ) {
   delay(1000);
   Serial.println("Moving!");
@@ -409,6 +1083,48 @@ class OMMotorFunctions {
 
 public:
 
+        // one pre-calculated spline in a step timing table, see stepTable()
+    struct s_stepTiming {
+        uint16_t off_cycles;            // Off cycles between steps, saturated at 65535 where no step can be taken in the spline
+        uint16_t cycle_err;             // Off cycle error, multiplied by FLOAT_TOLERANCE
+    };
+
+        // execution time record of one profiled function, see profile()
+    struct s_profile {
+        unsigned long calls;            // Number of calls timed
+        unsigned int min;               // Shortest call (clock counts)
+        unsigned int max;               // Longest call (clock counts)
+        unsigned long total;            // Sum of all calls timed (clock counts)
+    };
+
+        // one position trigger, see triggerTable()
+    struct s_trigger {
+        long pos;                       // Position at which the trigger fires
+        uint8_t id;                     // Passed to the trigger handler
+    };
+
+        // one queued move segment, see segmentQueue()
+    struct s_segment {
+        uint8_t dir;                    // Direction to move
+        unsigned long steps;            // Distance to move (steps)
+        unsigned long time;             // Total travel time (mS)
+        unsigned long accel;            // Time spent accelerating (mS)
+        unsigned long decel;            // Time spent decelerating (mS)
+        float entry_speed;              // Junction speed at the start of the segment (steps / spline), planned by queueMove()
+        float exit_speed;               // Junction speed at the end of the segment (steps / spline), planned by queueMove()
+    };
+
+        // feasibility of a move or plan, see analyzeMove()
+    struct s_moveCheck {
+        unsigned long steps;            // Steps to travel, including any backlash take-up
+        unsigned long time;             // Travel time (mS) - for plans, of the longest shot's move
+        float peak_speed;               // Highest speed (steps / second)
+        float peak_accel;               // Highest acceleration (steps / second^2)
+        unsigned int isr_rate;          // Lowest maxStepRate() able to run the move, or 0 if none can
+        uint8_t over;                   // OM_MOT_OVER_* flags of the limits broken, 0 if feasible
+        unsigned long fit;              // Nearest feasible travel time (mS) - for plans, number of shots
+    };
+
 
     OMMotorFunctions(int, int, int, int, int, int, int, int);
     ~OMMotorFunctions();
@@ -423,6 +1139,8 @@ public:
     unsigned int backlash();
 
     void setHandler(void(*)(uint8_t));
+    void poll();
+    unsigned int eventsDropped();
 
     unsigned int curSamplePeriod();
 
@@ -432,6 +1150,12 @@ public:
     void maxSpeed(unsigned int);
     unsigned int maxSpeed();
 
+    void maxAccel(float);
+    float maxAccel();
+
+    void maxJerk(float);
+    float maxJerk();
+
     void enable(uint8_t);
     uint8_t enable();
 
@@ -443,6 +1167,9 @@ public:
 
     void contSpeed(float);
     float contSpeed();
+
+    void feedRate(uint8_t);
+    uint8_t feedRate();
     float desiredSpeed();
 
     uint8_t running();
@@ -471,6 +1198,13 @@ public:
     void planRun();     //used move
     void planReverse(); //used move
 
+    void planSchedule(uint8_t*, unsigned int);
+    uint8_t planScheduled();
+    unsigned int planScheduleSize();
+    unsigned long planSteps();
+    unsigned int planChecksum();
+    uint8_t planVerify();
+
     void homeSet();
     void endPos(long);
     long endPos();
@@ -508,6 +1242,12 @@ public:
 
     void checkRefresh();
     uint8_t checkStep();
+    uint8_t checkStepTimed();
+    unsigned long stepPeriod();
+    uint8_t checkStepCompare();
+    unsigned int compareTicks();
+    void compareClock(uint8_t);
+    uint8_t compareClock();
 
     void planLeadIn(unsigned int);
     void planLeadOut(unsigned int);
@@ -532,7 +1272,39 @@ public:
     volatile uint8_t splineReady;
     uint8_t endOfMove;
 
+    uint8_t splineGeneration();
+
+    void stepTrace(uint16_t*, uint8_t);
+    uint8_t traceAvailable();
+    uint8_t traceDrain(uint16_t*, uint8_t);
+    unsigned int traceDropped();
+
+    void triggerTable(s_trigger*, uint8_t);
+    uint8_t addTrigger(long, uint8_t);
+    uint8_t removeTrigger(uint8_t);
+    void clearTriggers();
+    uint8_t triggers();
+    void setTriggerHandler(void(*)(uint8_t));
+
+    s_profile profile(uint8_t);
+    unsigned long profile(uint8_t, uint8_t);
+    void profileReset();
+    unsigned int missedSplines();
+    void missedSplines(unsigned int);
+
+    void stepTable(s_stepTiming*, uint8_t);
+    uint8_t stepTableCompiled();
+    unsigned int stepTableUnderruns();
+    s_stepTiming stepTableEntry(uint8_t);
+
+    void segmentQueue(s_segment*, uint8_t);
+    uint8_t queueMove(uint8_t, unsigned long, unsigned long, unsigned long, unsigned long);
+    uint8_t queued();
+    void clearQueue();
+
     float getTopSpeed();
+    uint8_t analyzeMove(uint8_t, unsigned long, unsigned long, unsigned long, unsigned long, s_moveCheck*);
+    uint8_t analyzePlan(unsigned long, uint8_t, unsigned long, unsigned long, unsigned long, s_moveCheck*);
 
     // Setting and retrieving of motor units code
     void units(int);
@@ -583,11 +1355,11 @@ private:
     uint8_t m_programDone;
 
     struct s_splineCal {
-        float accel_fraction;           // Acceleration percentage of total move
-        float decel_fraction;           // Deceleration percentage of total move
-        float cruise_fraction;          // Constant speed percentage of toal move
+        om_ease_t accel_fraction;       // Acceleration percentage of total move
+        om_ease_t decel_fraction;       // Deceleration percentage of total move
+        om_ease_t cruise_fraction;      // Constant speed percentage of toal move
         float top_speed;                // SMS: max steps required during any single movement interval -- Continuous: top speed in steps / sec
-        float decel_start;              // Percentage of total move when deceleration begins
+        om_ease_t decel_start;          // Percentage of total move when deceleration begins
         float easing_coeff;             // 1/travel = distance covered during accel/decel compared to same time at continuous speed
         float accel_coeff;              // Steps (SMS) or steps/s (CONT) per acceleration calculation unit. This is actually the coefficient of the power function y = ax^2 or linear function y = mx
         float decel_coeff;              // Steps (SMS) or steps/s (CONT) per deceleration calculation unit. This is actually the coefficient of the power function y = ax^2 or linear function y = mx
@@ -597,6 +1369,22 @@ private:
         unsigned long accel_moves;      // Number of SMS acceleration moves
         unsigned long cruise_moves;     // Number of SMS cruise moves
         unsigned long decel_moves;      // Number of SMS deceleration moves
+        om_ease_t start_speed;          // Continuous: speed the acceleration ramp starts from (steps / spline)
+        om_ease_t end_speed;            // Continuous: speed the deceleration ramp ends at (steps / spline)
+        om_ease_t start_scale;          // Continuous: 1 - start_speed / top_speed
+        om_ease_t end_scale;            // Continuous: 1 - end_speed / top_speed
+#ifdef OM_MOT_FIXED_EASING
+        long fx_top_speed;              // Continuous: top speed in steps / spline (Q16.16)
+        unsigned long fx_accel_inv;     // Continuous: 1 / accel_fraction (Q16.16)
+        unsigned long fx_decel_inv;     // Continuous: 1 / decel_fraction (Q16.16)
+#endif
+        uint8_t fd_state;               // Forward differencing state, OM_EASE_FD_*
+        uint8_t fd_epoch;               // Continuous: m_splineEpoch when fd_state was set
+        unsigned long fd_next;          // Spline (or shot) whose speed is held in fd_speed
+        unsigned long fd_end;           // Last spline (or shot) the differences hold for
+        om_fdiff_t fd_speed;            // Speed at fd_next (Q32.32 in fixed-point)
+        om_fdiff_t fd_d1;               // First difference of speed
+        om_fdiff_t fd_d2;               // Second difference of speed
     };
 
 
@@ -604,29 +1392,110 @@ private:
 
     s_splineCal m_splineOne;
     s_splineCal m_splinePlanned;
+#ifdef OM_MOT_SEGMENTS
+    s_splineCal m_splineNext;
+#endif
 
     void _stepsAsync(uint8_t, unsigned long);
+    void _stopMove();
 
     void _updateMotorHome(int);
-    void _fireCallback(uint8_t);
+#ifdef OM_MOT_STEP_TRACE
+    void _traceStep();
+    uint8_t _tracePut(uint16_t);
+#endif
+#ifdef OM_MOT_TRIGGERS
+    void _checkTriggers(int);
+    void _seekTriggers();
+#endif
+        // one plan schedule segment being compiled, see _compilePlan()
+    struct s_planSeg {
+        unsigned long base;                     // Base steps per shot
+        unsigned int len;                       // Shots in the segment
+        uint8_t extra;                          // Some shot takes base + 1 steps
+        uint8_t bits[32];                       // Shots taking base + 1 steps
+    };
 
-    void _initSpline(uint8_t, float, unsigned long, unsigned long, unsigned long);
-    static void _linearEasing(uint8_t, float, OMMotorFunctions*);
-    static void _quadEasing(uint8_t, float, OMMotorFunctions*);
-    static void _SMSErrorCalc(const float&, float&, s_splineCal*, OMMotorFunctions*);
-    static void _contErrorCalc(const float&, float&, OMMotorFunctions*);
+    uint8_t _compilePlan(unsigned long, unsigned long, unsigned long);
+    uint8_t _planPut(uint8_t);
+    uint8_t _planFlush(s_planSeg*, unsigned long*);
+    unsigned long _planNext();
+    unsigned long _planSeek(unsigned long);
+    unsigned int _planChecksum();
+    void _fireCallback(uint8_t);
+    void _queueEvent(uint8_t, uint8_t);
+
+    void _initSpline(uint8_t, float, unsigned long, unsigned long, unsigned long, s_splineCal* p_spline = 0);
+    void _blendSpline(s_splineCal*, float, unsigned long, float, float);
+    static void _linearEasing(uint8_t, om_ease_t, OMMotorFunctions*);
+    static void _quadEasing(uint8_t, om_ease_t, OMMotorFunctions*);
+    static void _easeSpeed(uint8_t, om_ease_t, OMMotorFunctions*);
+    static om_ease_t _easeStep(s_splineCal*, unsigned long, om_ease_t, OMMotorFunctions*, uint8_t);
+    static void _easeFit(s_splineCal*, unsigned long, OMMotorFunctions*, uint8_t);
+    static om_ease_t _easeSample(s_splineCal*, unsigned long, OMMotorFunctions*, uint8_t);
+    static uint8_t _easePiece(s_splineCal*, unsigned long, OMMotorFunctions*, uint8_t);
+    void _easeSpline(unsigned long);
+    static void _SMSErrorCalc(const om_ease_t&, float&, s_splineCal*, OMMotorFunctions*);
+    static void _contErrorCalc(const om_ease_t&, om_ease_t&, OMMotorFunctions*);
     static unsigned long _partialSum(unsigned long);
     static unsigned long _partialSumOfSquares(unsigned long);
+    static om_ease_t _easePercent(unsigned long, unsigned long);
+#ifdef OM_MOT_FIXED_EASING
+    static unsigned long _easeMul(unsigned long, unsigned long);
+    static unsigned long _easeInverse(float);
+#endif
 
 
+    void _rampPeaks(float*, float*);
+    void _solveMove(float, float, float, float*, float*);
+    float _shotPeak(float, float, float*, float*);
+    float _movePeak(float, unsigned long, unsigned long, unsigned long);
+    uint8_t _checkPeak(s_moveCheck*, float, float);
     void _setEasingCoeff(OMMotorFunctions::s_splineCal*);
 
-    static float _qEaseCalc(OMMotorFunctions::s_splineCal*, float, OMMotorFunctions*, uint8_t);
-    static float _qInvCalc(OMMotorFunctions::s_splineCal*, float, OMMotorFunctions*, uint8_t);
+    static om_ease_t _linCalc(OMMotorFunctions::s_splineCal*, om_ease_t, OMMotorFunctions*, uint8_t);
+    static om_ease_t _qEaseCalc(OMMotorFunctions::s_splineCal*, om_ease_t, OMMotorFunctions*, uint8_t);
+    static om_ease_t _qInvCalc(OMMotorFunctions::s_splineCal*, om_ease_t, OMMotorFunctions*, uint8_t);
+    static om_ease_t _sCurveCalc(OMMotorFunctions::s_splineCal*, om_ease_t, OMMotorFunctions*, uint8_t);
+    static om_ease_t _sCurveShape(om_ease_t);
 
     void _updateContSpeed();
 
+    void _publishSpline();
+    uint8_t _feedSpline(uint8_t);
+    void _feedLimit(float);
+    void _discardSplines();
+    uint8_t _advanceSpline();
+    uint8_t _limitViolation();
+    uint8_t _limitReached();
+    unsigned long _limitSteps();
+    void _recheckLimit();
+    void _timedTarget();
+
+#ifdef OM_MOT_STEP_TABLE
+    void _initStepTable();
+    void _fillStepTable();
+    void _nextTableSpline();
+#endif
+
+#ifdef OM_MOT_SEGMENTS
+    void _prepareSegment();
+    void _startSegment();
+    static float _junctionSpeed(s_segment*, s_segment*);
+#endif
+    uint8_t _nextSegment();
+    uint8_t _stepsDone();
+    void _startSpline(s_splineCal*, unsigned long, unsigned long, unsigned long);
+
+    uint8_t _retarget(long);
+    float _retargetRamps(float, float, float, uint8_t, float*, float*);
+    float _rampTime(float);
+    float _rampPoint(float);
+    float _rampCovered(float);
+
     unsigned int m_maxSpeed;
+    float m_maxAccel;                           // Acceleration limit for simple moves (steps/s^2)
+    float m_maxJerk;                            // Jerk limit for simple moves (steps/s^3), 0 = none
 
     uint8_t m_backCheck;
     uint8_t m_motEn;
@@ -645,6 +1514,7 @@ private:
     volatile int m_cycleErrAccumulated;
     volatile unsigned long m_cyclesLow;
     volatile unsigned long m_stepsTaken;
+    volatile unsigned long m_limitLeft;         // Steps which can be taken before the limits need checking
     volatile unsigned long m_totalCyclesTaken;
 
     unsigned long m_asyncSteps;                 // Number of steps in a specified move
@@ -671,6 +1541,18 @@ private:
     volatile float m_curPlanErr;
     uint8_t m_planDir;                          // Planned move direction
 
+    uint8_t* m_planBuf;                         // Plan schedule buffer supplied by planSchedule(), or 0
+    unsigned int m_planBufSize;                 // Size of the plan schedule buffer, in bytes
+    unsigned int m_planBytes;                   // Bytes used by the compiled schedule
+    uint8_t m_planSched;                        // The current plan is being run from its schedule
+    unsigned long m_planSum;                    // Total steps in the compiled schedule
+    unsigned int m_planCheck;                   // Checksum of the compiled schedule
+    unsigned int m_planPos;                     // Schedule read cursor: next segment header
+    unsigned int m_planLeft;                    // Schedule read cursor: shots left in the current segment
+    uint8_t m_planIdx;                          // Schedule read cursor: shot within the current segment
+    unsigned int m_planMap;                     // Schedule read cursor: bitmap of the current segment, or 0
+    unsigned long m_planBase;                   // Schedule read cursor: base steps of the current segment
+
     unsigned long m_Steps;                      // Number of steps since start of programmed move. This is not used in the NMX firmware, could be depreciated
     float m_contSpd;                            // Motor's current continuous speed (steps/s)
     float m_desiredContSpd;                     // Motor's target continuous speed (steps/s)
@@ -686,7 +1568,7 @@ private:
 
     uint8_t m_curMs;                            // Current microstepping value
     unsigned int m_backAdj;                     // Backlash adjustment steps (must be adjusted when microstepping changes)
-    uint8_t m_easeType;                         // Easing mode: linear, quadratic, or inv. quadratic
+    uint8_t m_easeType;                         // Easing mode: linear, quadratic, inv. quadratic, or S-curve
 
     float m_top_speed;
 
@@ -698,13 +1580,126 @@ private:
     float m_plat_ratio;
 
     void(*f_motSignal)(uint8_t);
-    void(*f_easeFunc)(uint8_t, float, OMMotorFunctions*);
-    float(*f_easeCal)(OMMotorFunctions::s_splineCal*, float, OMMotorFunctions*, uint8_t);
+    void(*f_easeFunc)(uint8_t, om_ease_t, OMMotorFunctions*);
+    om_ease_t(*f_easeCal)(OMMotorFunctions::s_splineCal*, om_ease_t, OMMotorFunctions*, uint8_t);
+    unsigned long m_easeSpline;                 // Continuous: spline being evaluated by f_easeFunc, see _easeSpline()
 
     uint8_t m_programBackCheck;
 
     uint8_t m_calcMove;
 
+#ifdef OM_MOT_STEP_TABLE
+    // Step timing table variables
+    s_stepTiming* m_stepTable;                  // Table buffer supplied by stepTable(), or 0 when not used
+    uint8_t m_tblSize;                          // Number of entries in the table buffer
+    volatile uint8_t m_tblHead;                 // Next entry to be written (main loop only)
+    volatile uint8_t m_tblTail;                 // Next entry to be read (ISR only)
+    volatile uint8_t m_tblActive;               // Current move is being driven from the table
+    uint8_t m_tblCompiled;                      // Whole current move fit in the table
+    unsigned long m_tblSpline;                  // Next spline number to be written to the table
+    volatile unsigned int m_tblUnderruns;       // Splines for which the ISR found no table entry
+    unsigned int m_tblLow;                      // Most cycles since the last step at the end of the last entry written
+#endif
+
+#ifdef OM_MOT_STEP_TRACE
+    // Step trace variables
+    uint16_t* m_trace;                          // Trace buffer supplied by stepTrace(), or 0 when not used
+    uint8_t m_traceSize;                        // Number of entries in the trace buffer
+    volatile uint8_t m_traceHead;               // Next entry to be written (ISR only)
+    volatile uint8_t m_traceTail;               // Next entry to be drained (main loop only)
+    unsigned long m_traceTicks;                 // Stepping cycles since the last traced step
+    unsigned long m_traceUs;                    // checkStepTimed(): microseconds since the last traced step, less whole cycles
+    volatile unsigned int m_traceDropped;       // Entries lost because the trace buffer was full
+#endif
+
+#ifdef OM_MOT_TRIGGERS
+    // Position trigger variables
+    s_trigger* m_trig;                          // Trigger table supplied by triggerTable(), or 0 when not used
+    uint8_t m_trigSize;                         // Number of entries in the trigger table
+    uint8_t m_trigCount;                        // Triggers set, in order of position
+    volatile uint8_t m_trigLo;                  // First trigger at or above the current position
+    volatile uint8_t m_trigHi;                  // First trigger above the current position
+    void(*f_trigSignal)(uint8_t);
+#endif
+
+    // Event queue variables
+    struct s_event {
+        uint8_t kind;                           // OM_MOT_EVT_*
+        uint8_t code;                           // Signal code, trigger id or debug message
+    };
+
+    s_event m_events[OM_MOT_EVENTS + 1];        // Events waiting for poll(), one entry always left empty
+    volatile uint8_t m_evHead;                  // Next event to be queued
+    volatile uint8_t m_evTail;                  // Next event to be passed on (poll() only)
+    volatile unsigned int m_evDropped;          // Events lost because the queue was full
+
+#ifdef OM_MOT_PROFILE
+    // Profiling variables
+    s_profile m_profile[OM_MOT_PROF_COUNT];
+
+        // times from construction until it goes out of scope
+    struct s_profTimer {
+        OMMotorFunctions* mot;
+        uint8_t which;
+        unsigned long start;
+
+        s_profTimer(OMMotorFunctions* p_mot, uint8_t p_which) : mot(p_mot), which(p_which), start(OM_MOT_PROFILE_CLOCK()) { }
+        ~s_profTimer() { mot->_profile(which, OM_MOT_PROFILE_CLOCK() - start); }
+    };
+
+    void _profile(uint8_t, unsigned long);
+#endif
+
+    // Spline handoff variables
+    struct s_splineTiming {
+        unsigned long off_cycles;               // Off cycles between steps
+        unsigned int cycle_err;                 // Off cycle error, multiplied by FLOAT_TOLERANCE
+        uint8_t end;                            // End of the move was reached instead
+        uint8_t epoch;                          // Value of m_splineEpoch when calculated
+    };
+
+    s_splineTiming m_splineBuf[2];              // Spline n is handed over in m_splineBuf[n & 1]
+    volatile uint8_t m_splineGen;               // Splines handed over (main loop only)
+    volatile uint8_t m_splineUsed;              // Splines consumed (ISR only)
+    volatile uint8_t m_splineBusy;              // _publishSpline() is part-way through a calculation
+    volatile uint8_t m_splineEpoch;             // Advanced by the ISR when a new move makes handed over splines stale
+
+    uint8_t m_feedOn;                           // Splines are calculated by _feedSpline(), see feedRate()
+    uint8_t m_feedEpoch;                        // m_splineEpoch of the move m_feedPos belongs to
+    float m_feed;                               // Current feed rate override factor
+    float m_feedTarget;                         // Factor m_feed is slewing towards
+    float m_feedPos;                            // Position in the move's own time (splines) reached by the override
+    volatile unsigned int m_splineMissed;       // Spline boundaries reached before the next spline was handed over
+
+    // Variable-period stepping variables
+    unsigned long m_usLow;                      // Microseconds since the last step
+    unsigned long m_usSpline;                   // Microseconds elapsed in the current spline
+    unsigned long m_usTarget;                   // Microseconds between steps at the current speed
+    unsigned int m_usErrAccumulated;            // Fractional microseconds carried between steps, multiplied by FLOAT_TOLERANCE
+    volatile unsigned long m_stepPeriod;        // Period until checkStepTimed() must next be called
+
+    // Output-compare stepping variables
+    uint8_t m_cmpClock;                         // Timer ticks per microsecond
+    uint8_t m_cmpStep;                          // The event being loaded is a step
+    uint8_t m_cmpEval;                          // checkStepTimed() has been called for the event being loaded
+    unsigned long m_cmpLeft;                    // Ticks until the event being loaded, less those already loaded
+    volatile unsigned int m_cmpTicks;           // Ticks to add to the compare register, 0 once the move has completed
+
+#ifdef OM_MOT_SEGMENTS
+    // Segment queue variables
+    s_segment* m_segQueue;                      // Queue buffer supplied by segmentQueue(), or 0 when not used
+    uint8_t m_segSize;                          // Number of entries in the queue buffer
+    volatile uint8_t m_segHead;                 // Next entry to be queued (main loop only)
+    volatile uint8_t m_segTail;                 // Next entry to be started (ISR only, once prepared)
+    volatile uint8_t m_segReady;                // m_splineNext holds the spline for the entry at m_segTail
+    unsigned long m_segSteps;                   // Steps of the prepared segment, including backlash
+    unsigned long m_segSplines;                 // Splines in the prepared segment
+#endif
+
+    // Retargeting variables
+    volatile uint8_t m_retarget;                // Stopping to turn back to m_retargetPos, see _retarget()
+    long m_retargetPos;                         // Position to send the motor to once stopped
+
     // Key Frame variables
     struct key_frame {
         long dest[10];
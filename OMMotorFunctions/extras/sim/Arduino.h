@@ -0,0 +1,108 @@
+/*
+
+Host Simulation Arduino Layer
+
+OpenMoco nanoMoCo Core Engine Libraries
+
+See www.openmoco.org for more information
+
+(c) 2008-2011 C.A. Church / Dynamic Perception LLC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+*/
+
+    // Stands in for the Arduino core when OMMotorFunctions is built on a
+    // host for simulation.  Time is virtual: micros() and millis() read
+    // g_simMicros, which only advances when the simulator (or delay()) says so.
+
+#ifndef OM_SIM_ARDUINO_H
+#define OM_SIM_ARDUINO_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define OM_SIM_PINS 64
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0
+#define OUTPUT  1
+
+#define DEC     10
+#define HEX     16
+
+#ifndef _BV
+#define _BV(b) (1 << (b))
+#endif
+
+#ifndef abs
+#define abs(x) ((x)>0?(x):-(x))
+#endif
+
+    // no interrupts on the host, the simulator calls the ISR itself; the
+    // interrupt flag is still kept in SREG, and is clear during the ISR
+#define SREG_I  7
+#define cli()   (SREG &= ~_BV(SREG_I))
+#define sei()   (SREG |= _BV(SREG_I))
+
+extern uint8_t SREG;
+
+    // the stepping cycle may be fired from inside updateSpline(), see
+    // OMMotorSim::preempt()
+extern void (*g_simPreempt)();
+
+#define OM_MOT_PREEMPT() do { if( g_simPreempt != 0 ) g_simPreempt(); } while( 0 )
+
+extern volatile unsigned long g_simMicros;
+extern uint8_t g_simPins[OM_SIM_PINS];
+
+inline unsigned long micros() { return(g_simMicros); }
+inline unsigned long millis() { return(g_simMicros / 1000); }
+inline void delay(unsigned long p_ms) { g_simMicros += p_ms * 1000; }
+inline void delayMicroseconds(unsigned int p_us) { g_simMicros += p_us; }
+
+inline void pinMode(uint8_t, uint8_t) { }
+
+inline void digitalWrite(uint8_t p_pin, uint8_t p_val) {
+    if( p_pin < OM_SIM_PINS )
+        g_simPins[p_pin] = p_val;
+}
+
+inline int digitalRead(uint8_t p_pin) {
+    return( p_pin < OM_SIM_PINS ? g_simPins[p_pin] : LOW );
+}
+
+    // serial output goes to stderr, to keep it apart from simulator results
+class OMSimSerial {
+public:
+    void begin(unsigned long) { }
+    void print(const char* p_str) { fputs(p_str, stderr); }
+    void print(long p_val, int p_base = DEC) { fprintf(stderr, p_base == HEX ? "%lx" : "%ld", p_val); }
+    void print(double p_val) { fprintf(stderr, "%f", p_val); }
+    template<class T> void println(T p_val) { print(p_val); fputc('\n', stderr); }
+    template<class T> void println(T p_val, int p_base) { print((long) p_val, p_base); fputc('\n', stderr); }
+};
+
+extern OMSimSerial Serial;
+extern OMSimSerial USBSerial;
+
+#endif
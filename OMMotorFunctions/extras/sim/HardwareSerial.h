@@ -0,0 +1,2 @@
+    // Host simulation: serial ports are provided by Arduino.h
+#include "Arduino.h"
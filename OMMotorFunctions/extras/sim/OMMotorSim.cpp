@@ -0,0 +1,722 @@
+/*
+
+Host Motor Simulator
+
+OpenMoco nanoMoCo Core Engine Libraries
+
+See www.openmoco.org for more information
+
+(c) 2008-2011 C.A. Church / Dynamic Perception LLC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+*/
+
+#include "OMMotorSim.h"
+
+    // the fake Arduino layer's globals
+volatile unsigned long g_simMicros = 0;
+uint8_t g_simPins[OM_SIM_PINS];
+uint8_t SREG = _BV(SREG_I);
+void (*g_simPreempt)() = 0;
+OMSimSerial Serial;
+OMSimSerial USBSerial;
+TimerOne Timer1;
+
+OMMotorSim* OMMotorSim::g_sim = 0;
+
+/** Constructor
+
+ Creates a simulator for the given motor, and attaches its stepping cycle to
+ the simulated Timer1 at the motor's current sample period.
+
+ @param p_motor
+ The motor to simulate
+
+ */
+
+OMMotorSim::OMMotorSim(OMMotorFunctions& p_motor) : m_motor(p_motor) {
+
+    g_sim = this;
+
+    m_timed = false;
+    m_compare = false;
+    m_cmpArmed = false;
+    m_preempt = false;
+    m_seed = 1;
+    m_loopUs = 1000;
+    m_trace = 0;
+    m_traceUs = 0;
+
+    m_start = 0;
+    m_startPos = 0;
+    m_startMissed = 0;
+    m_nextIsr = 0;
+    m_nextLoop = 0;
+    m_nextTrace = 0;
+    m_tracePos = 0;
+
+    m_steps = 0;
+    m_lastStep = 0;
+    m_done = 0;
+    m_window = 0;
+    m_windowSteps = 0;
+    m_peakSteps = 0;
+    m_doneSignals = 0;
+    m_chaseTarget = 0;
+    m_chaseDist = 0;
+    m_chaseDone = 0;
+
+    Timer1.initialize(m_motor.curSamplePeriod());
+    Timer1.attachInterrupt(_stepISR);
+    m_nextIsr = g_simMicros + Timer1.period;
+}
+
+/** Set Timed Stepping
+
+ Selects whether the simulated interrupt calls checkStep() every sample
+ period (the default), or checkStepTimed() with the timer re-programmed from
+ stepPeriod() after each call.
+
+ @param p_timed
+ true to use checkStepTimed()
+
+ */
+
+void OMMotorSim::timed(bool p_timed) {
+    m_timed = p_timed;
+}
+
+/** Get Timed Stepping
+
+ @return
+ true if checkStepTimed() is in use
+ */
+
+bool OMMotorSim::timed() {
+    return(m_timed);
+}
+
+/** Set Output-Compare Stepping
+
+ Selects whether the simulated interrupt calls checkStepCompare(), taking
+ each step at the following interrupt, as the compare hardware would.  The
+ simulated timer counts in microseconds, so this sets the motor's
+ compareClock() to 1.  Takes precedence over timed().
+
+ @param p_compare
+ true to use checkStepCompare()
+
+ */
+
+void OMMotorSim::compare(bool p_compare) {
+
+    m_compare = p_compare;
+
+    if( m_compare )
+        m_motor.compareClock(1);
+}
+
+/** Get Output-Compare Stepping
+
+ @return
+ true if checkStepCompare() is in use
+ */
+
+bool OMMotorSim::compare() {
+    return(m_compare);
+}
+
+/** Set Preemption
+
+ Selects whether the stepping cycle is also fired from inside updateSpline(),
+ at each of the points marked by OM_MOT_PREEMPT() in the library, as the
+ Timer1 interrupt could fire there on the Arduino.  Each time, virtual time
+ runs on through a pseudo-random number of sample periods, from none up to a
+ whole spline, firing the stepping cycle at each, before updateSpline()
+ carries on.  This tests the paths which hand splines over between the main
+ loop and the stepping cycle, at the cost of the arrival time: a spline the
+ main loop is held up calculating is missed.
+
+ @param p_preempt
+ true to fire the stepping cycle from inside updateSpline()
+
+ */
+
+void OMMotorSim::preempt(bool p_preempt) {
+    m_preempt = p_preempt;
+    g_simPreempt = p_preempt ? _preemptHook : 0;
+}
+
+/** Get Preemption
+
+ @return
+ true if the stepping cycle is fired from inside updateSpline()
+ */
+
+bool OMMotorSim::preempt() {
+    return(m_preempt);
+}
+
+/** Set Main Loop Period
+
+ Sets how often, in virtual microseconds, the simulated main loop calls
+ updateSpline().  Longer periods model a busier main loop, and will show up
+ as missed splines once the loop can no longer keep up.
+
+ @param p_us
+ Main loop period, in microseconds
+
+ */
+
+void OMMotorSim::loopPeriod(unsigned long p_us) {
+    m_loopUs = p_us > 0 ? p_us : 1;
+}
+
+/** Get Main Loop Period
+
+ @return
+ Main loop period, in microseconds
+ */
+
+unsigned long OMMotorSim::loopPeriod() {
+    return(m_loopUs);
+}
+
+/** Set Trace Output
+
+ Writes a CSV row of time (mS from the start of the run), position and
+ velocity (steps/second, over the trace period) to the given file every
+ p_us virtual microseconds during each run.  Pass a null file to stop
+ tracing.
+
+ @param p_file
+ File to write to, or 0
+
+ @param p_us
+ Trace period, in microseconds
+
+ */
+
+void OMMotorSim::trace(FILE* p_file, unsigned long p_us) {
+
+    m_trace = p_us > 0 ? p_file : 0;
+    m_traceUs = p_us;
+
+    if( m_trace != 0 )
+        fprintf(m_trace, "time_ms,pos,vel\n");
+}
+
+/** Run a Move
+
+ Runs move() with the given parameters to completion.
+
+ @param p_Dir
+ The direction to move
+
+ @param p_Dist
+ The distance to move (steps)
+
+ @param p_Time
+ The total time to travel to the new position (mS)
+
+ @param p_Accel
+ The travel time spent accelerating to full speed (mS)
+
+ @param p_Decel
+ The travel time spent decelerating back to a stop (mS)
+
+ @return
+ The result of the run
+ */
+
+OMMotorSim::s_simResult OMMotorSim::runMove(uint8_t p_Dir, unsigned long p_Dist, unsigned long p_Time, unsigned long p_Accel, unsigned long p_Decel) {
+
+    _begin();
+
+    m_motor.move(p_Dir, p_Dist, p_Time, p_Accel, p_Decel);
+    _startTimer();
+
+    bool done = _advance(m_start + OM_SIM_RUN_LIMIT, true);
+
+    return(_result(! done));
+}
+
+/** Run a Move with a Feed Rate Override
+
+ Moves as runMove() does, changing the feed rate override with feedRate() to
+ the given percentage once the move has run for p_At, and setting it back to
+ 100% once the move is done.
+
+ @param p_Dir
+ Direction of travel
+
+ @param p_Dist
+ Number of steps to travel
+
+ @param p_Time
+ Total travel time, as planned (mS)
+
+ @param p_Accel
+ The planned travel time spent accelerating from a stop (mS)
+
+ @param p_Decel
+ The planned travel time spent decelerating back to a stop (mS)
+
+ @param p_At
+ Time into the move at which the override is changed (mS)
+
+ @param p_Percent
+ Feed rate override, as passed to feedRate()
+
+ @return
+ The result of the run
+ */
+
+OMMotorSim::s_simResult OMMotorSim::runFeed(uint8_t p_Dir, unsigned long p_Dist, unsigned long p_Time, unsigned long p_Accel, unsigned long p_Decel, unsigned long p_At, uint8_t p_Percent) {
+
+    _begin();
+
+    m_motor.move(p_Dir, p_Dist, p_Time, p_Accel, p_Decel);
+    _startTimer();
+
+    bool done = _advance(m_start + p_At * 1000, true);
+
+    m_motor.feedRate(p_Percent);
+
+    if( ! done )
+        done = _advance(m_start + OM_SIM_RUN_LIMIT, true);
+
+    m_motor.feedRate(100);
+
+    return(_result(! done));
+}
+
+/** Run a Simple Move
+
+ Moves with the two-argument form of move(), which solves for the shortest
+ move at the given speed within the motor's maxAccel() and maxJerk() limits.
+
+ @param p_Dir
+ Direction of travel
+
+ @param p_Dist
+ Number of steps to travel
+
+ @param p_Speed
+ Highest speed, in steps/second, as set with contSpeed()
+
+ @return
+ The result of the run
+ */
+
+OMMotorSim::s_simResult OMMotorSim::runSimple(uint8_t p_Dir, unsigned long p_Dist, float p_Speed) {
+
+    _begin();
+
+    m_motor.contSpeed(p_Speed);
+    m_motor.move(p_Dir, p_Dist);
+    _startTimer();
+
+    bool done = _advance(m_start + OM_SIM_RUN_LIMIT, true);
+
+    return(_result(! done));
+}
+
+/** Run a Plan
+
+ Plans a shoot-move-shoot move with plan(), then executes every shot with
+ planRun(), letting each shot's move complete and then idling for the given
+ interval before the next.
+
+ @param p_Shots
+ Number of intervals in the plan.
+
+ @param p_Dir
+ Direction of travel for the plan
+
+ @param p_Dist
+ Number of steps to travel total
+
+ @param p_Accel
+ Number of intervals during which acceleration occurs
+
+ @param p_Decel
+ Number of intervals during which deceleration occurs
+
+ @param p_Interval
+ Time to idle after each shot's move (mS)
+
+ @return
+ The result of the run
+ */
+
+OMMotorSim::s_simResult OMMotorSim::runPlan(unsigned long p_Shots, uint8_t p_Dir, unsigned long p_Dist, unsigned long p_Accel, unsigned long p_Decel, unsigned long p_Interval) {
+
+    _begin();
+
+    m_motor.plan(p_Shots, p_Dir, p_Dist, p_Accel, p_Decel);
+
+    if( m_motor.planScheduled() && ! m_motor.planVerify() )
+        return(_result(true));
+
+    for( unsigned long i = 0; i < p_Shots; i++ ) {
+
+        m_motor.planRun();
+        _startTimer();
+
+        if( ! _advance(m_start + OM_SIM_RUN_LIMIT, true) )
+            return(_result(true));
+
+        _advance(g_simMicros + p_Interval * 1000, false);
+    }
+
+    return(_result(false));
+}
+
+/** Run Continuously
+
+ Runs a continuous move at the given speed for the given time, then stops
+ the motor.  The continuous acceleration rate set with contAccel() applies.
+
+ @param p_Speed
+ Speed, in steps/second.  Negative speeds move in the reverse direction.
+
+ @param p_Time
+ Time to run for (mS)
+
+ @return
+ The result of the run
+ */
+
+OMMotorSim::s_simResult OMMotorSim::runContinuous(float p_Speed, unsigned long p_Time) {
+
+    _begin();
+
+    m_motor.continuous(true);
+    m_motor.contSpeed(fabs(p_Speed));
+    m_motor.move(p_Speed >= 0.0, 0);
+    _startTimer();
+
+    _advance(m_start + p_Time * 1000, false);
+
+    m_motor.stop();
+    m_motor.continuous(false);
+    m_done = g_simMicros;
+
+    return(_result(false));
+}
+
+/** Run a Chase
+
+ Follows a target moving away from the motor's position at a steady speed,
+ as a joystick or tracking loop would, by calling moveTo() with the target's
+ next position every p_Interval.  If p_Reverse is given, the target turns
+ back every p_Reverse, moving back and forth between the motor's position and
+ a point p_Reverse away.  The target stops after p_Time, and the run then
+ carries on until the motor arrives at it.
+
+ The motor's handler is replaced for the run, to count the OM_MOT_DONE
+ signals received while the target was moving, other than on stopping at
+ the target.  The result's chase_distance and chase_done give the position
+ and the count at the moment the target stopped.
+
+ @param p_Dir
+ Direction the target moves in
+
+ @param p_Speed
+ Speed of the target, in steps/second
+
+ @param p_Interval
+ Time between calls to moveTo() (mS)
+
+ @param p_Time
+ Time the target moves for (mS)
+
+ @param p_Reverse
+ Time between the target's turns (mS), or 0 to move steadily away
+
+ @return
+ The result of the run
+ */
+
+OMMotorSim::s_simResult OMMotorSim::runChase(uint8_t p_Dir, float p_Speed, unsigned long p_Interval, unsigned long p_Time, unsigned long p_Reverse) {
+
+    _begin();
+
+        // the signals of earlier runs may still be queued
+    m_motor.poll();
+    m_motor.setHandler(_signal);
+
+    if( p_Interval < 1 )
+        p_Interval = 1;
+
+    for( unsigned long t = 0; t < p_Time; t += p_Interval ) {
+
+            // head for where the target will be at the next call
+        unsigned long next = p_Time - t > p_Interval ? t + p_Interval : p_Time;
+        unsigned long away = next;
+
+        if( p_Reverse > 0 ) {
+            away = next % p_Reverse;
+            if( (next / p_Reverse) % 2 )
+                away = p_Reverse - away;
+        }
+
+        long dist = (long) (p_Speed * away / 1000.0 + 0.5);
+        m_chaseTarget = p_Dir ? dist : -dist;
+
+        m_motor.moveTo(m_startPos + m_chaseTarget);
+
+        if( t == 0 || ! Timer1.running )
+            _startTimer();
+
+        _advance(m_start + next * 1000, false);
+    }
+
+    m_chaseDist = m_motor.currentPos() - m_startPos;
+    m_chaseDone = m_doneSignals;
+
+    bool done = _advance(m_start + OM_SIM_RUN_LIMIT, true);
+
+        // a motor brought to rest to turn back is sent on to the target by
+        // the next main loop pass, so it has only arrived if it stays there
+    while( done ) {
+        _advance(g_simMicros + m_loopUs, false);
+
+        if( ! m_motor.running() )
+            break;
+
+        done = _advance(m_start + OM_SIM_RUN_LIMIT, true);
+    }
+
+    m_motor.setHandler(0);
+
+    return(_result(! done));
+}
+
+ // the simulated Timer1 interrupt
+void OMMotorSim::_stepISR() {
+
+    if( g_sim == 0 )
+        return;
+
+        // interrupts are disabled on entry, and enabled again on return
+    uint8_t oldSREG = SREG;
+    cli();
+
+    g_sim->_isr();
+
+    SREG = oldSREG;
+}
+
+ // called by the library at each OM_MOT_PREEMPT()
+void OMMotorSim::_preemptHook() {
+    if( g_sim != 0 )
+        g_sim->_preempt();
+}
+
+ // the stepping cycle interrupting updateSpline(): only when interrupts are
+ // enabled, so never from the stepping cycle itself
+void OMMotorSim::_preempt() {
+
+    if( ! (SREG & _BV(SREG_I)) || ! Timer1.running || Timer1.isrCallback == 0 )
+        return;
+
+    unsigned long cycles = (unsigned long) MS_PER_SPLINE * 1000 / Timer1.period;
+
+    m_seed = m_seed * 1103515245UL + 12345UL;
+    unsigned long fire = (m_seed >> 16) % (cycles + 1);
+
+    while( fire-- > 0 && Timer1.running ) {
+        if( m_nextIsr > g_simMicros )
+            g_simMicros = m_nextIsr;
+
+        Timer1.isrCallback();
+        m_nextIsr = g_simMicros + Timer1.period;
+    }
+}
+
+ // the motor's handler during a chase, counting the OM_MOT_DONE signals
+ // received while the motor is away from the target
+void OMMotorSim::_signal(uint8_t p_Code) {
+    if( g_sim != 0 && p_Code == OM_MOT_DONE && g_sim->m_motor.currentPos() != g_sim->m_startPos + g_sim->m_chaseTarget )
+        g_sim->m_doneSignals++;
+}
+
+void OMMotorSim::_isr() {
+
+    if( m_compare ) {
+            // the pin was raised by the compare this interrupt follows,
+            // which may have been loaded before the move was stopped
+        if( m_cmpArmed )
+            _step();
+
+        m_cmpArmed = m_motor.checkStepCompare();
+
+        if( m_motor.compareTicks() > 0 )
+            Timer1.setPeriod(m_motor.compareTicks());
+        else
+            Timer1.stop();
+        return;
+    }
+
+        // the stepping cycle is only serviced while a move is running,
+        // as the firmware's interrupt does
+    if( ! m_motor.running() ) {
+        if( m_timed )
+            Timer1.stop();
+        return;
+    }
+
+    m_motor.checkRefresh();
+
+    uint8_t step = m_timed ? m_motor.checkStepTimed() : m_motor.checkStep();
+
+    if( step )
+        _step();
+
+    if( m_timed ) {
+        if( m_motor.stepPeriod() > 0 )
+            Timer1.setPeriod(m_motor.stepPeriod());
+        else
+            Timer1.stop();
+    }
+}
+
+ // count a step taken now
+void OMMotorSim::_step() {
+
+        // close any peak speed windows that have passed
+    while( g_simMicros >= m_window ) {
+        if( m_windowSteps > m_peakSteps )
+            m_peakSteps = m_windowSteps;
+        m_windowSteps = 0;
+        m_window += (unsigned long) MS_PER_SPLINE * 1000;
+    }
+
+    m_steps++;
+    m_windowSteps++;
+    m_lastStep = g_simMicros;
+}
+
+ // reset the per-run measurements
+void OMMotorSim::_begin() {
+
+    m_start = g_simMicros;
+    m_startPos = m_motor.currentPos();
+    m_startMissed = m_motor.missedSplines();
+
+    m_steps = 0;
+    m_lastStep = m_start;
+    m_done = m_start;
+    m_window = m_start + (unsigned long) MS_PER_SPLINE * 1000;
+    m_windowSteps = 0;
+    m_peakSteps = 0;
+    m_doneSignals = 0;
+    m_chaseTarget = 0;
+    m_chaseDist = 0;
+    m_chaseDone = 0;
+
+    m_nextLoop = g_simMicros;
+    m_nextTrace = g_simMicros;
+    m_tracePos = m_startPos;
+}
+
+ // (re)start the timer at the sample period, as a sketch does on each move
+void OMMotorSim::_startTimer() {
+
+    Timer1.setPeriod(m_motor.curSamplePeriod());
+    Timer1.start();
+    m_cmpArmed = false;
+    m_nextIsr = g_simMicros + Timer1.period;
+}
+
+ // run virtual time up to p_until, returns true if the motor stopped first
+ // (only checked when p_whileRunning is set)
+bool OMMotorSim::_advance(unsigned long p_until, bool p_whileRunning) {
+
+    while( true ) {
+
+        if( p_whileRunning && ! m_motor.running() ) {
+            m_done = g_simMicros;
+            return(true);
+        }
+
+        if( g_simMicros >= p_until )
+            return(false);
+
+            // skip to the next event
+        unsigned long next = p_until;
+
+        if( Timer1.running && Timer1.isrCallback != 0 && m_nextIsr < next )
+            next = m_nextIsr;
+        if( m_nextLoop < next )
+            next = m_nextLoop;
+        if( m_trace != 0 && m_nextTrace < next )
+            next = m_nextTrace;
+
+            // delay() may already have moved the clock past an event
+        if( next > g_simMicros )
+            g_simMicros = next;
+
+        if( Timer1.running && Timer1.isrCallback != 0 && g_simMicros >= m_nextIsr ) {
+            Timer1.isrCallback();
+            m_nextIsr = g_simMicros + Timer1.period;
+        }
+
+        if( g_simMicros >= m_nextLoop ) {
+            m_motor.updateSpline();
+
+                // timed stepping stops the timer between moves
+            if( ! Timer1.running && m_motor.running() )
+                _startTimer();
+
+            m_nextLoop = g_simMicros + m_loopUs;
+        }
+
+        if( m_trace != 0 && g_simMicros >= m_nextTrace ) {
+            long pos = m_motor.currentPos();
+            float vel = (float) (pos - m_tracePos) * 1000000.0 / (float) m_traceUs;
+
+            fprintf(m_trace, "%.3f,%ld,%.1f\n", (float) (g_simMicros - m_start) / 1000.0, pos - m_startPos, vel);
+
+            m_tracePos = pos;
+            m_nextTrace = g_simMicros + m_traceUs;
+        }
+    }
+}
+
+ // collect the measurements of the run just finished
+OMMotorSim::s_simResult OMMotorSim::_result(bool p_timeout) {
+
+    s_simResult res;
+
+    if( m_windowSteps > m_peakSteps )
+        m_peakSteps = m_windowSteps;
+
+    res.distance = m_motor.currentPos() - m_startPos;
+    res.steps = m_steps;
+    res.arrival_us = m_done - m_start;
+    res.last_step_us = m_lastStep - m_start;
+    res.peak_speed = (float) m_peakSteps * (1000.0 / MS_PER_SPLINE);
+    res.missed = m_motor.missedSplines() - m_startMissed;
+    res.timeout = p_timeout;
+    res.chase_target = m_chaseTarget;
+    res.chase_distance = m_chaseDist;
+    res.chase_done = m_chaseDone;
+
+    return(res);
+}
@@ -0,0 +1,162 @@
+/*
+
+Host Motor Simulator
+
+OpenMoco nanoMoCo Core Engine Libraries
+
+See www.openmoco.org for more information
+
+(c) 2008-2011 C.A. Church / Dynamic Perception LLC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+*/
+
+#ifndef OM_MOTORSIM_H
+#define OM_MOTORSIM_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "TimerOne.h"
+#include "OMMotorFunctions.h"
+
+    // Longest a single run may take, in virtual uS, before it is abandoned
+#define OM_SIM_RUN_LIMIT    3600000000UL
+
+/**
+
+  @brief
+  Host-side virtual-time simulator for OMMotorFunctions
+
+  The OMMotorSim class runs an OMMotorFunctions object on a desktop machine,
+  against the fake Arduino and Timer1 layers found alongside it.  The stepping
+  cycle is fired by the simulated Timer1, and the main loop duties
+  (updateSpline()) are performed at a fixed virtual interval, so that a move
+  of several minutes completes in milliseconds of real time.
+
+  Each run returns an s_simResult describing what the motor actually did, and
+  a position/velocity trace may be written as CSV while it runs.  Peak speed
+  is measured over windows of one spline (MS_PER_SPLINE), the same resolution
+  at which the library varies its speed.
+
+  @code
+OMMotorFunctions Motor = OMMotorFunctions(0, 0, 0, 0, 0, 0, 0, 0);
+OMMotorSim Sim = OMMotorSim(Motor);
+
+Motor.enable(true);
+OMMotorSim::s_simResult res = Sim.runMove(1, 5000, 10000, 2000, 2000);
+
+if( res.distance != 5000 )
+  printf("missed target by %ld steps\n", res.distance - 5000);
+  @endcode
+
+  Only one OMMotorSim may exist at a time, as there is only one Timer1.
+
+  @author C. A. Church
+
+  (c) 2011 C. A. Church / Dynamic Perception
+
+  */
+
+class OMMotorSim {
+
+public:
+
+    struct s_simResult {
+        long distance;              // Change in position over the run
+        unsigned long steps;        // Steps taken during the run
+        unsigned long arrival_us;   // Time the motor stopped running, from the start of the run
+        unsigned long last_step_us; // Time of the last step, from the start of the run
+        float peak_speed;           // Highest speed seen over one spline, steps/second
+        unsigned int missed;        // Splines the stepping cycle had to hold for (see missedSplines())
+        bool timeout;               // The run was abandoned after OM_SIM_RUN_LIMIT
+        long chase_target;          // Final position of a chase's target, from the start of the run
+        long chase_distance;        // Change in position when a chase's target stopped moving
+        unsigned int chase_done;    // OM_MOT_DONE signals received away from the target before then
+    };
+
+    OMMotorSim(OMMotorFunctions&);
+
+    void timed(bool);
+    bool timed();
+
+    void compare(bool);
+    bool compare();
+
+    void preempt(bool);
+    bool preempt();
+
+    void loopPeriod(unsigned long);
+    unsigned long loopPeriod();
+
+    void trace(FILE*, unsigned long);
+
+    s_simResult runMove(uint8_t, unsigned long, unsigned long, unsigned long, unsigned long);
+    s_simResult runFeed(uint8_t, unsigned long, unsigned long, unsigned long, unsigned long, unsigned long, uint8_t);
+    s_simResult runSimple(uint8_t, unsigned long, float);
+    s_simResult runPlan(unsigned long, uint8_t, unsigned long, unsigned long, unsigned long, unsigned long);
+    s_simResult runContinuous(float, unsigned long);
+    s_simResult runChase(uint8_t, float, unsigned long, unsigned long, unsigned long = 0);
+
+private:
+
+    OMMotorFunctions& m_motor;
+
+    bool m_timed;                   // Use checkStepTimed() rather than checkStep()
+    bool m_compare;                 // Use checkStepCompare(), taking steps at the compare
+    bool m_cmpArmed;                // The next compare raises the step pin
+    bool m_preempt;                 // Fire the stepping cycle from inside updateSpline()
+    unsigned long m_seed;           // Pseudo-random state for preemption
+    unsigned long m_loopUs;         // Virtual time between main loop passes
+    FILE* m_trace;                  // Position/velocity trace output, or 0
+    unsigned long m_traceUs;        // Virtual time between trace rows
+
+    unsigned long m_start;          // Start of the current run
+    long m_startPos;                // Motor position at the start of the run
+    unsigned int m_startMissed;     // Missed splines count at the start of the run
+    unsigned long m_nextIsr;        // Next Timer1 interrupt
+    unsigned long m_nextLoop;       // Next main loop pass
+    unsigned long m_nextTrace;      // Next trace row
+    long m_tracePos;                // Position at the last trace row
+
+    unsigned long m_steps;
+    unsigned long m_lastStep;       // Time of the last step
+    unsigned long m_done;           // Time the motor stopped running
+    unsigned long m_window;         // End of the current peak speed window
+    unsigned long m_windowSteps;    // Steps taken in the current window
+    unsigned long m_peakSteps;      // Most steps taken in any window
+    unsigned int m_doneSignals;     // OM_MOT_DONE signals received away from the target
+    long m_chaseTarget;             // Final position of the chase's target
+    long m_chaseDist;               // Change in position when the chase ended
+    unsigned int m_chaseDone;       // OM_MOT_DONE signals received before the chase ended
+
+    static OMMotorSim* g_sim;
+
+    static void _stepISR();
+    static void _preemptHook();
+    static void _signal(uint8_t);
+    void _isr();
+    void _preempt();
+    void _step();
+    void _begin();
+    void _startTimer();
+    bool _advance(unsigned long, bool);
+    s_simResult _result(bool);
+
+};
+
+#endif
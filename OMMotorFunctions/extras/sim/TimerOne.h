@@ -0,0 +1,57 @@
+/*
+
+Host Simulation Timer1
+
+OpenMoco nanoMoCo Core Engine Libraries
+
+See www.openmoco.org for more information
+
+(c) 2008-2011 C.A. Church / Dynamic Perception LLC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+*/
+
+    // Same interface as the TimerOne library, but the timer only records its
+    // period and callback.  OMMotorSim fires the callback in virtual time.
+
+#ifndef OM_SIM_TIMERONE_H
+#define OM_SIM_TIMERONE_H
+
+#include "Arduino.h"
+
+class TimerOne {
+
+public:
+
+    TimerOne() : period(1000000), running(false), isrCallback(0) { }
+
+    void initialize(long p_us = 1000000) { setPeriod(p_us); running = false; }
+    void start() { running = true; }
+    void stop() { running = false; }
+    void restart() { running = true; }
+    void resume() { running = true; }
+    void attachInterrupt(void (*p_isr)(), long p_us = -1) { if( p_us > 0 ) setPeriod(p_us); isrCallback = p_isr; running = true; }
+    void detachInterrupt() { isrCallback = 0; }
+    void setPeriod(long p_us) { period = p_us > 0 ? p_us : 1; }
+
+    long period;
+    bool running;
+    void (*isrCallback)();
+};
+
+extern TimerOne Timer1;
+
+#endif
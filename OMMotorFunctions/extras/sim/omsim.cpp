@@ -0,0 +1,243 @@
+/*
+
+Host Motor Simulator - Batch Runner
+
+OpenMoco nanoMoCo Core Engine Libraries
+
+See www.openmoco.org for more information
+
+(c) 2008-2011 C.A. Church / Dynamic Perception LLC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+*/
+
+    // Reads one run per line from stdin and prints one result line for each,
+    // see README.md.  Exits non-zero if any run fails its checks.
+
+#include <unistd.h>
+
+#include "OMMotorSim.h"
+
+    // a global, as on the Arduino, so that it starts zeroed
+OMMotorFunctions Motor = OMMotorFunctions(0, 0, 0, 0, 0, 0, 0, 0);
+
+static void usage() {
+    fprintf(stderr, "usage: omsim [-t] [-c] [-P] [-e easing] [-r rate] [-a accel] [-j jerk] [-S speed] [-l loop_us] [-m tolerance_ms] [-p trace.csv] [-i trace_us] [-s sched_bytes] [-T table_entries] < runs\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+
+    bool timed = false;
+    bool compare = false;
+    bool preempt = false;
+    int easing = -1;
+    unsigned int rate = 0;
+    float accel = 0.0;
+    float jerk = -1.0;
+    unsigned int speed = 0;
+    unsigned long loopUs = 1000;
+    unsigned long tolerance = MS_PER_SPLINE;
+    const char* traceFile = 0;
+    unsigned long traceUs = 10000;
+    unsigned int schedBytes = 0;
+    unsigned int tableSize = 0;
+    int opt;
+
+    while( (opt = getopt(argc, argv, "tcPe:r:a:j:S:l:m:p:i:s:T:")) != -1 ) {
+        switch( opt ) {
+            case 't': timed = true; break;
+            case 'c': compare = true; break;
+            case 'P': preempt = true; break;
+            case 'e': easing = atoi(optarg); break;
+            case 'r': rate = atoi(optarg); break;
+            case 'a': accel = atof(optarg); break;
+            case 'j': jerk = atof(optarg); break;
+            case 'S': speed = atoi(optarg); break;
+            case 'l': loopUs = strtoul(optarg, 0, 10); break;
+            case 'm': tolerance = strtoul(optarg, 0, 10); break;
+            case 'p': traceFile = optarg; break;
+            case 'i': traceUs = strtoul(optarg, 0, 10); break;
+            case 's': schedBytes = strtoul(optarg, 0, 10); break;
+            case 'T': tableSize = strtoul(optarg, 0, 10); break;
+            default: usage();
+        }
+    }
+
+    if( rate > 0 )
+        Motor.maxStepRate(rate);
+    if( easing >= 0 )
+        Motor.easing(easing);
+    if( accel > 0.0 )
+        Motor.maxAccel(accel);
+    if( jerk >= 0.0 )
+        Motor.maxJerk(jerk);
+    if( speed > 0 )
+        Motor.maxSpeed(speed);
+
+    Motor.enable(true);
+
+    if( schedBytes > 0 )
+        Motor.planSchedule((uint8_t*) malloc(schedBytes), schedBytes);
+
+        // only used when built with OM_MOT_STEP_TABLE
+    if( tableSize > 0 )
+        Motor.stepTable((OMMotorFunctions::s_stepTiming*) malloc(tableSize * sizeof(OMMotorFunctions::s_stepTiming)), tableSize);
+
+    OMMotorSim sim = OMMotorSim(Motor);
+    sim.timed(timed);
+    sim.compare(compare);
+    sim.preempt(preempt);
+    sim.loopPeriod(loopUs);
+
+    FILE* trace = 0;
+
+    if( traceFile != 0 ) {
+        trace = fopen(traceFile, "w");
+        if( trace == 0 ) {
+            perror(traceFile);
+            return(2);
+        }
+        sim.trace(trace, traceUs);
+    }
+
+    char line[256];
+    unsigned long runs = 0;
+    unsigned long failed = 0;
+
+    while( fgets(line, sizeof(line), stdin) != 0 ) {
+
+        char kind[16];
+        unsigned long a, b, c, d = 0, e, f, g;
+        float spd;
+        float peakLimit = -1.0;     // peak speed is only checked for feed and check runs
+        bool checked = true;        // check runs' analysis matched
+        OMMotorFunctions::s_moveCheck check;
+        OMMotorSim::s_simResult res;
+        long expectDist = 0;
+        long expectMs = -1;     // arrival time is only checked for single moves
+        long directDist = 0;    // only set for chases
+
+        if( sscanf(line, "%15s", kind) != 1 || kind[0] == '#' )
+            continue;
+
+        if( strcmp(kind, "move") == 0 && sscanf(line, "%*s %lu %lu %lu %lu %lu", &a, &b, &c, &d, &e) == 5 ) {
+                // move dir dist time accel decel
+            res = sim.runMove(a, b, c, d, e);
+            expectDist = a ? (long) b : -(long) b;
+            expectMs = c;
+        }
+        else if( strcmp(kind, "feed") == 0 && sscanf(line, "%*s %lu %lu %lu %lu %lu %lu %lu", &a, &b, &c, &d, &e, &f, &g) == 7 ) {
+                // feed dir dist time accel decel at percent -- the override
+                // re-times the move, but may raise its planned peak speed no
+                // higher than maxSpeed() and maxStepRate()
+            Motor.analyzeMove(a, b, c, d, e, &check);
+
+            float limit = Motor.maxSpeed() < Motor.maxStepRate() ? Motor.maxSpeed() : Motor.maxStepRate();
+            peakLimit = check.peak_speed;
+
+            if( g > 100 ) {
+                peakLimit = check.peak_speed * g / 100.0;
+                if( peakLimit > limit )
+                    peakLimit = check.peak_speed > limit ? check.peak_speed : limit;
+            }
+
+            res = sim.runFeed(a, b, c, d, e, f, g);
+            expectDist = a ? (long) b : -(long) b;
+        }
+        else if( strcmp(kind, "check") == 0 && sscanf(line, "%*s %lu %lu %lu %lu %lu %lu %lu", &a, &b, &c, &d, &e, &f, &g) == 7 ) {
+                // check dir dist time accel decel isr_rate over -- the move
+                // is analyzed, and must need the given stepping rate and
+                // break the given OM_MOT_OVER_* limits, then made at the
+                // travel time suggested, where it must stay within the limits
+            uint8_t feasible = Motor.analyzeMove(a, b, c, d, e, &check);
+            checked = check.isr_rate == f && check.over == g && feasible == (g == 0);
+
+            peakLimit = Motor.maxSpeed() < Motor.maxStepRate() ? Motor.maxSpeed() : Motor.maxStepRate();
+            res = sim.runMove(a, b, check.fit, d, e);
+            expectDist = a ? (long) b : -(long) b;
+        }
+        else if( strcmp(kind, "simple") == 0 && sscanf(line, "%*s %lu %lu %f", &a, &b, &spd) == 3 ) {
+                // simple dir dist speed -- the arrival time is solved by move()
+            res = sim.runSimple(a, b, spd);
+            expectDist = a ? (long) b : -(long) b;
+        }
+        else if( strcmp(kind, "plan") == 0 && sscanf(line, "%*s %lu %lu %lu %lu %lu %lu", &a, &b, &c, &d, &e, &f) == 6 ) {
+                // plan shots dir dist accel decel interval
+            res = sim.runPlan(a, b, c, d, e, f);
+            expectDist = b ? (long) c : -(long) c;
+        }
+        else if( strcmp(kind, "cont") == 0 && sscanf(line, "%*s %f %lu", &spd, &a) == 2 ) {
+                // cont speed time -- reported only, the ramp makes the distance inexact
+            res = sim.runContinuous(spd, a);
+            expectDist = res.distance;
+        }
+        else if( strcmp(kind, "chase") == 0 && sscanf(line, "%*s %lu %f %lu %lu %lu", &a, &spd, &b, &c, &d) >= 4 ) {
+                // chase dir speed interval time [reverse] -- a steady chase
+                // is compared against a single move to the same position,
+                // made first
+            if( d == 0 )
+                directDist = sim.runChase(a, spd, c, c).chase_distance;
+            res = sim.runChase(a, spd, b, c, d);
+            expectDist = res.chase_target;
+        }
+        else {
+            fprintf(stderr, "bad run: %s", line);
+            failed++;
+            continue;
+        }
+
+        bool ok = ! res.timeout && res.distance == expectDist;
+
+            // a chase must never signal OM_MOT_DONE away from its target, and
+            // must keep up with the single move to within 10%
+        if( res.chase_done > 0 || labs(res.chase_distance) * 10 < labs(directDist) * 9 )
+            ok = false;
+
+            // one step more in a spline than the speed allows is rounding
+        if( peakLimit >= 0.0 && res.peak_speed > floor(peakLimit + 0.5) + 1000.0 / MS_PER_SPLINE )
+            ok = false;
+
+        if( ! checked )
+            ok = false;
+
+        if( expectMs >= 0 && labs((long) (res.arrival_us / 1000) - expectMs) > (long) tolerance )
+            ok = false;
+
+        printf("%s dist %ld/%ld arrive %.1fms last step %.1fms peak %.0f missed %u ",
+            kind, res.distance, expectDist, res.arrival_us / 1000.0, res.last_step_us / 1000.0,
+            res.peak_speed, res.missed);
+
+        if( strcmp(kind, "check") == 0 )
+            printf("rate %u over %u fit %lu ", check.isr_rate, check.over, check.fit);
+
+        if( strcmp(kind, "chase") == 0 )
+            printf("chased %ld/%ld done %u ", res.chase_distance, directDist, res.chase_done);
+
+        printf("%s\n", res.timeout ? "TIMEOUT" : ok ? "ok" : "FAIL");
+
+        runs++;
+        if( ! ok )
+            failed++;
+    }
+
+    if( trace != 0 )
+        fclose(trace);
+
+    fprintf(stderr, "%lu runs, %lu failed\n", runs, failed);
+
+    return( failed > 0 ? 1 : 0 );
+}
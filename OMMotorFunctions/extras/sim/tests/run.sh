@@ -0,0 +1,92 @@
+#!/bin/sh
+#
+# Builds omsim in the float and fixed-point easing builds, and with every
+# optional feature built in, and runs the test run files against each, see
+# ../README.md.  Exits non-zero if any test fails.
+#
+# usage: tests/run.sh   (from the extras/sim directory, or anywhere else)
+
+cd "$(dirname "$0")/.." || exit 2
+
+CXX=${CXX:-g++}
+OUT=${TMPDIR:-/tmp}/omsim-tests.$$
+SRC="omsim.cpp OMMotorSim.cpp ../../OMMotorFunctions.cpp"
+FEATURES="-DOM_MOT_STEP_TABLE -DOM_MOT_SEGMENTS -DOM_MOT_STEP_TRACE -DOM_MOT_TRIGGERS -DOM_MOT_PROFILE"
+FAIL=0
+
+mkdir -p "$OUT" || exit 2
+trap 'rm -rf "$OUT"' EXIT
+
+$CXX -O2 -I. -I../.. -o "$OUT/omsim" $SRC || exit 2
+$CXX -O2 -DOM_MOT_FIXED_EASING -I. -I../.. -o "$OUT/omsim-fixed" $SRC || exit 2
+$CXX -O2 $FEATURES -I. -I../.. -o "$OUT/omsim-full" $SRC || exit 2
+
+fail() {
+    echo "FAIL: $*"
+    FAIL=1
+}
+
+    # every plan lands exactly, for every easing, and the fixed-point build
+    # lands every shot where the float build does (the continuous curve is
+    # only close to the float one, so arrival times may differ slightly)
+for e in 0 1 2 3 4; do
+    "$OUT/omsim" -e $e < tests/plans.txt > "$OUT/float" 2>/dev/null || fail "plans, float, easing $e"
+    "$OUT/omsim-fixed" -e $e < tests/plans.txt > "$OUT/fixed" 2>/dev/null || fail "plans, fixed, easing $e"
+    cut -d' ' -f1-3 "$OUT/float" > "$OUT/float.dist"
+    cut -d' ' -f1-3 "$OUT/fixed" > "$OUT/fixed.dist"
+    cmp -s "$OUT/float.dist" "$OUT/fixed.dist" || fail "plans, float and fixed differ, easing $e"
+
+        # the optional features change nothing unless they are used
+    "$OUT/omsim-full" -e $e < tests/plans.txt > "$OUT/full" 2>/dev/null || fail "plans, all features, easing $e"
+    cmp -s "$OUT/float" "$OUT/full" || fail "plans, all features differ, easing $e"
+    "$OUT/omsim-full" -e $e -T 8 < tests/plans.txt > /dev/null 2>&1 || fail "plans, step table, easing $e"
+
+        # and still land exactly with the stepping cycle firing from inside
+        # updateSpline(), though held splines change their timing
+    "$OUT/omsim" -P -e $e < tests/plans.txt > /dev/null 2>&1 || fail "plans, preempted, float, easing $e"
+    "$OUT/omsim-fixed" -P -e $e < tests/plans.txt > /dev/null 2>&1 || fail "plans, preempted, fixed, easing $e"
+    "$OUT/omsim-full" -P -e $e < tests/plans.txt > /dev/null 2>&1 || fail "plans, preempted, all features, easing $e"
+    "$OUT/omsim" -t -P -e $e < tests/plans.txt > /dev/null 2>&1 || fail "plans, preempted, timed, easing $e"
+done
+
+    # moves land exactly and on time, whether calculated spline by spline or
+    # from a step timing table, refilled as it goes or holding the whole move
+for e in 0 1 2 3 4; do
+    "$OUT/omsim" -e $e < tests/moves.txt > /dev/null 2>&1 || fail "moves, float, easing $e"
+    "$OUT/omsim-fixed" -e $e < tests/moves.txt > /dev/null 2>&1 || fail "moves, fixed, easing $e"
+    for t in 8 255; do
+        "$OUT/omsim-full" -e $e -T $t < tests/moves.txt > /dev/null 2>&1 || fail "moves, step table of $t, easing $e"
+    done
+done
+
+    # a feed rate override changed part way through a move re-times it, but
+    # it still lands exactly, and the override saturates at maxSpeed() (1000
+    # by default) or at maxStepRate()
+for e in 0 1 2 3 4; do
+    for s in 1000 5000; do
+        "$OUT/omsim" -e $e -S $s < tests/feed.txt > /dev/null 2>&1 || fail "feed, float, max speed $s, easing $e"
+        "$OUT/omsim-fixed" -e $e -S $s < tests/feed.txt > /dev/null 2>&1 || fail "feed, fixed, max speed $s, easing $e"
+        "$OUT/omsim" -t -e $e -S $s < tests/feed.txt > /dev/null 2>&1 || fail "feed, timed, max speed $s, easing $e"
+    done
+done
+
+    # analyzeMove() reports the stepping rate and the limits a move needs,
+    # and the travel time it suggests keeps the move within them
+for e in 0 1 2 3 4; do
+    "$OUT/omsim" -e $e < tests/check.txt > /dev/null 2>&1 || fail "check, float, easing $e"
+    "$OUT/omsim-fixed" -e $e < tests/check.txt > /dev/null 2>&1 || fail "check, fixed, easing $e"
+done
+
+    # moveTo() on a running motor follows its target without signalling
+    # OM_MOT_DONE on the way, and arrives exactly
+for e in 0 1 2 3 4; do
+    "$OUT/omsim" -e $e < tests/chase.txt > /dev/null 2>&1 || fail "chase, float, easing $e"
+    "$OUT/omsim-fixed" -e $e < tests/chase.txt > /dev/null 2>&1 || fail "chase, fixed, easing $e"
+    "$OUT/omsim-full" -e $e < tests/chase.txt > /dev/null 2>&1 || fail "chase, all features, easing $e"
+done
+
+if [ $FAIL -eq 0 ]; then
+    echo "all tests passed"
+fi
+
+exit $FAIL
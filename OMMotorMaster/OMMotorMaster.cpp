@@ -0,0 +1,178 @@
+/*
+
+Motor Master Library
+
+OpenMoco nanoMoCo Core Engine Libraries
+
+See www.openmoco.org for more information
+
+(c) 2008-2011 C.A. Church / Dynamic Perception LLC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+*/
+
+#include "OMMotorMaster.h"
+
+// initialize static members
+
+OMMotorFunctions* OMMotorMaster::g_motors[OM_MOT_COUNT] = { 0, 0, 0 };
+volatile uint8_t  OMMotorMaster::g_lastSteps = 0;
+
+
+/** Set Motors
+
+ Sets the motors to be driven by stepISR().  Motor 1 steps on OM_MOT1_STPFLAG,
+ motor 2 on OM_MOT2_STPFLAG, and motor 3 on OM_MOT3_STPFLAG.
+
+ A null pointer may be passed for any motor that is not to be driven.
+
+ @param p_mot1
+ Motor 1
+
+ @param p_mot2
+ Motor 2
+
+ @param p_mot3
+ Motor 3
+
+ */
+
+void OMMotorMaster::motors(OMMotorFunctions* p_mot1, OMMotorFunctions* p_mot2, OMMotorFunctions* p_mot3) {
+
+    uint8_t oldSREG = SREG;
+    cli();
+
+    g_motors[0] = p_mot1;
+    g_motors[1] = p_mot2;
+    g_motors[2] = p_mot3;
+
+    SREG = oldSREG;
+}
+
+/** Get Motor
+
+ Returns the motor driven on the given step line (0-2).
+
+ @param p_which
+ Motor number, zero-indexed
+
+ @return
+ A pointer to the motor, or null if none is set
+
+ */
+
+OMMotorFunctions* OMMotorMaster::motor(uint8_t p_which) {
+
+    if( p_which >= OM_MOT_COUNT )
+        return(0);
+
+    return(g_motors[p_which]);
+}
+
+/** Step Interrupt Service Routine
+
+ Evaluates every motor once, and takes all due steps with a single write of the
+ step register.  Attach this method to Timer1, running at the motors'
+ sample period.
+
+ */
+
+void OMMotorMaster::stepISR() {
+
+    uint8_t steps = 0;
+
+#ifndef OM_MOT_SPLIT_STPREG
+
+        // bring down the step lines raised during the last pass
+    if( g_lastSteps != 0 )
+        OM_MOT1_STPREG &= ~g_lastSteps;
+
+        // all step pins on one port, collect the pin bits directly
+    if( _check(0) ) steps |= _BV(OM_MOT1_STPFLAG);
+    if( _check(1) ) steps |= _BV(OM_MOT2_STPFLAG);
+    if( _check(2) ) steps |= _BV(OM_MOT3_STPFLAG);
+
+    if( steps != 0 )
+        OM_MOT1_STPREG |= steps;
+
+#else
+
+    if( g_lastSteps & _BV(0) ) OM_MOT1_STPREG &= ~_BV(OM_MOT1_STPFLAG);
+    if( g_lastSteps & _BV(1) ) OM_MOT2_STPREG &= ~_BV(OM_MOT2_STPFLAG);
+    if( g_lastSteps & _BV(2) ) OM_MOT3_STPREG &= ~_BV(OM_MOT3_STPFLAG);
+
+        // collect motor numbers, and write each port
+    if( _check(0) ) steps |= _BV(0);
+    if( _check(1) ) steps |= _BV(1);
+    if( _check(2) ) steps |= _BV(2);
+
+    if( steps & _BV(0) ) OM_MOT1_STPREG |= _BV(OM_MOT1_STPFLAG);
+    if( steps & _BV(1) ) OM_MOT2_STPREG |= _BV(OM_MOT2_STPFLAG);
+    if( steps & _BV(2) ) OM_MOT3_STPREG |= _BV(OM_MOT3_STPFLAG);
+
+#endif
+
+    g_lastSteps = steps;
+}
+
+/** Update Splines
+
+ Calculates the next spline for every running motor, and starts or prepares
+ the next queued segment of any motor with segments queued.  Events queued by
+ every motor are passed to their handlers (see OMMotorFunctions::poll()).
+ Call this method from the main loop, so that speed calculations and
+ callbacks happen outside of stepISR().
+
+ */
+
+void OMMotorMaster::updateSplines() {
+
+    for( uint8_t i = 0; i < OM_MOT_COUNT; i++ ) {
+        if( g_motors[i] == 0 )
+            continue;
+
+        if( g_motors[i]->running() || g_motors[i]->queued() )
+            g_motors[i]->updateSpline();
+        else
+            g_motors[i]->poll();
+    }
+}
+
+/** Get Last Steps
+
+ Returns the step lines raised during the last pass of stepISR().
+
+ @return
+ Step register bits, or a bit for each motor number when OM_MOT_SPLIT_STPREG
+ is defined
+ */
+
+uint8_t OMMotorMaster::lastSteps() {
+    return(g_lastSteps);
+}
+
+ // run one motor's stepping cycle, returns true if it is due a step
+uint8_t OMMotorMaster::_check(uint8_t p_which) {
+
+    OMMotorFunctions* mot = g_motors[p_which];
+
+    if( mot == 0 || ! mot->running() )
+        return(false);
+
+    mot->checkRefresh();
+
+    return(mot->checkStep());
+}
@@ -1,3 +1,32 @@
+/*
+
+Motor Master Library
+
+OpenMoco nanoMoCo Core Engine Libraries
+
+See www.openmoco.org for more information
+
+(c) 2008-2011 C.A. Church / Dynamic Perception LLC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+*/
+
+#ifndef OM_MOTOR_MASTER_H
+#define OM_MOTOR_MASTER_H
+
 #include <inttypes.h>
  // must load before wconstants to prevent issues
 #include <math.h>
@@ -104,3 +133,76 @@
 #define OM_MOT_LINEAR   1
 #define OM_MOT_QUAD     2
 #define OM_MOT_QUADINV  3
+#define OM_MOT_SCURVE   4
+
+#define OM_MOT_COUNT    3
+
+
+/**
+
+  @brief
+  Multi-Axis Step Executor
+
+  The Motor Master drives the step lines of up to three OMMotorFunctions
+  objects from a single Timer1 interrupt service routine.
+
+  When each motor's checkStep() is run from its own piece of code, every motor
+  pays for its own port access and the step edges of coordinated moves are
+  skewed by the time taken to evaluate the motors before them.  The Motor
+  Master instead evaluates all motors in one pass, collects the step bits of
+  every motor which is due to step, and raises them all with a single
+  read-modify-write of the step register.  The step lines are brought low
+  together at the start of the next pass, so the high pulse lasts one sample
+  period and no time is spent waiting inside the interrupt.
+
+  All motors must use the same sample period (see OMMotorFunctions::maxStepRate()),
+  and by default all step pins are on the same port (OM_MOT1_STPREG).  If the
+  step registers are re-defined to different ports, define OM_MOT_SPLIT_STPREG
+  and each port is written separately.
+
+  @code
+#include "TimerOne.h"
+#include "OMMotorFunctions.h"
+#include "OMMotorMaster.h"
+
+OMMotorFunctions motor[OM_MOT_COUNT] = {
+  OMMotorFunctions(OM_MOT1_DSTEP, OM_MOT1_DDIR, OM_MOT1_DSLP, OM_MOT1_DMS1, OM_MOT1_DMS2, OM_MOT1_DMS3, OM_MOT1_STPREG, OM_MOT1_STPFLAG),
+  OMMotorFunctions(OM_MOT2_DSTEP, OM_MOT2_DDIR, OM_MOT2_DSLP, OM_MOT2_DMS1, OM_MOT2_DMS2, OM_MOT2_DMS3, OM_MOT2_STPREG, OM_MOT2_STPFLAG),
+  OMMotorFunctions(OM_MOT3_DSTEP, OM_MOT3_DDIR, OM_MOT3_DSLP, OM_MOT3_DMS1, OM_MOT3_DMS2, OM_MOT3_DMS3, OM_MOT3_STPREG, OM_MOT3_STPFLAG)
+};
+
+void setup() {
+  OMMotorMaster::motors(&motor[0], &motor[1], &motor[2]);
+  Timer1.initialize(motor[0].curSamplePeriod());
+  Timer1.attachInterrupt(OMMotorMaster::stepISR);
+}
+
+void loop() {
+  OMMotorMaster::updateSplines();
+}
+  @endcode
+
+  */
+
+class OMMotorMaster {
+
+public:
+
+    static void motors(OMMotorFunctions*, OMMotorFunctions*, OMMotorFunctions*);
+    static OMMotorFunctions* motor(uint8_t);
+
+    static void stepISR();
+    static void updateSplines();
+
+    static uint8_t lastSteps();
+
+private:
+
+    static OMMotorFunctions* g_motors[OM_MOT_COUNT];
+    static volatile uint8_t g_lastSteps;
+
+    static uint8_t _check(uint8_t);
+
+};
+
+#endif
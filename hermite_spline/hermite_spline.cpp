@@ -377,3 +377,89 @@ void HermiteSpline::cubic_spline_value(int nn, float xn[], float fn[],
 	}
 	return;
 }
+
+
+
+/******************************************************************************/
+
+void HermiteSpline::cubic_power_coefficients(float x1, float f1, float d1,
+	float x2, float f2, float d2, float c[])
+
+	/******************************************************************************/
+	/*
+	Purpose:
+
+	CUBIC_POWER_COEFFICIENTS converts a Hermite cubic to the power basis.
+
+	Discussion:
+
+	The Hermite cubic through (X1,F1,D1) and (X2,F2,D2) is
+
+	F(X) = C[0] + C[1] * T + C[2] * T^2 + C[3] * T^3,  T = X - X1.
+
+	These are the coefficients HERMITE_CUBIC_VALUE calculates on every call.
+	Calculating them once per interval and keeping them lets the cubic be
+	evaluated with CUBIC_POWER_VALUE at any number of points.
+
+	Parameters:
+
+	Input, float X1, F1, D1, the left endpoint, function value
+	and derivative.
+
+	Input, float X2, F2, D2, the right endpoint, function value
+	and derivative.
+
+	Output, float C[4], the power basis coefficients.
+	*/
+{
+	float df;
+	float h;
+
+	h = x2 - x1;
+	df = (f2 - f1) / h;
+
+	c[0] = f1;
+	c[1] = d1;
+	c[2] = -(2.0 * d1 - 3.0 * df + d2) / h;
+	c[3] = (d1 - 2.0 * df + d2) / h / h;
+	return;
+}
+
+/******************************************************************************/
+
+void HermiteSpline::cubic_power_value(float c[], float t, float *f, float *d,
+	float *s)
+
+	/******************************************************************************/
+	/*
+	Purpose:
+
+	CUBIC_POWER_VALUE evaluates a cubic from its power basis coefficients.
+
+	Discussion:
+
+	The value and derivatives are found by Horner's rule, sharing the
+	scaled derivative coefficients between them.
+
+	Parameters:
+
+	Input, float C[4], the coefficients from CUBIC_POWER_COEFFICIENTS.
+
+	Input, float T, the offset of the evaluation point from the left
+	endpoint, X - X1.
+
+	Output, float *F, *D, *S, the value and first two derivatives of
+	the cubic at X.
+	*/
+{
+	float d2;
+	float d3;
+
+	d2 = c[2] + c[2];
+	d3 = 3.0 * c[3];
+
+	*f = c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+	*d = c[1] + t * (d2 + t * d3);
+	*s = d2 + t * (d3 + d3);
+	return;
+}
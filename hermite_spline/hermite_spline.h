@@ -20,6 +20,10 @@ class HermiteSpline
 		 float f2, float d2, int n, float x[], float f[], float d[],
 		 float s[]);
 	 static void r8vec_bracket3(int n, float t[], float tval, int *left);
+	 static void cubic_power_coefficients(float x1, float f1, float d1,
+		 float x2, float f2, float d2, float c[]);
+	 static void cubic_power_value(float c[], float t, float *f, float *d,
+		 float *s);
  private:
 	 
 	
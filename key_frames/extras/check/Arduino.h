@@ -0,0 +1,40 @@
+/*
+
+Host Check Arduino Layer
+
+(c) 2015 Dynamic Perception LLC
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Stands in for the Arduino core when KeyFrames and HermiteSpline are built
+// on a host to be checked.  Only what those two classes use is provided.
+
+#ifndef _KF_CHECK_ARDUINO_h
+#define _KF_CHECK_ARDUINO_h
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+typedef uint8_t byte;
+
+// The Arduino abs() is a macro, so it works on floats as well
+#ifndef abs
+#define abs(x) ((x)>0?(x):-(x))
+#endif
+
+#endif
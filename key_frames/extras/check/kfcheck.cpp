@@ -0,0 +1,375 @@
+/*
+
+KeyFrames Host Check
+
+(c) 2015 Dynamic Perception LLC
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Checks KeyFrames against HermiteSpline::cubic_spline_value(), the evaluation it used before it kept the power
+// basis coefficients of each segment, over random key frames. See README.md. Exits non-zero if any check fails.
+
+#include <string.h>
+
+#include "key_frames.h"
+#include "hermite_spline.h"
+
+#define MAX_KF		8		// Most key frames on one axis
+#define MAX_AXES	6		// Most axes checked together
+#define POINTS		64		// Random points checked on each curve
+#define VAL_SAMPLES	4000	// Samples per segment when finding a curve's peaks by brute force
+
+static unsigned long g_seed = 1;
+static unsigned long g_checks = 0;
+static unsigned long g_failed = 0;
+static unsigned long g_interior = 0;	// Velocity peaks found between key frames
+
+// Repeatable on every host, unlike rand()
+static float randomFloat(float p_lo, float p_hi){
+	g_seed = g_seed * 1103515245UL + 12345UL;
+	return p_lo + (p_hi - p_lo) * ((g_seed >> 16) & 0x7FFF) / 32767.0;
+}
+
+// Random key frames in strictly ascending order from p_start
+static void randomFrames(int p_count, float p_start, float* p_xn, float* p_fn, float* p_dn){
+	float x = p_start;
+
+	for (int i = 0; i < p_count; i++){
+		p_xn[i] = x;
+		p_fn[i] = randomFloat(-5000, 5000);
+		p_dn[i] = randomFloat(-500, 500);
+		x += randomFloat(5, 100);
+	}
+}
+
+// The values before the power basis: the cubic of the segment cubic_spline_value() finds for x, or of either segment
+// when x is on a key frame between two of them, where the acceleration may differ
+struct s_ref {
+	float f[2];
+	float d[2];
+	float s[2];
+	int sides;
+};
+
+static void reference(int p_count, float* p_xn, float* p_fn, float* p_dn, float p_x, s_ref* p_ref){
+	float x = p_x;
+
+	// KeyFrames holds the curve's values outside of its first and last key frames
+	if (x < p_xn[0])
+		x = p_xn[0];
+	else if (x > p_xn[p_count - 1])
+		x = p_xn[p_count - 1];
+
+	HermiteSpline::cubic_spline_value(p_count, p_xn, p_fn, p_dn, 1, &x, &p_ref->f[0], &p_ref->d[0], &p_ref->s[0]);
+	p_ref->sides = 1;
+
+	for (int i = 1; i < p_count - 1; i++){
+		if (x == p_xn[i]){
+			HermiteSpline::cubic_value(p_xn[i - 1], p_fn[i - 1], p_dn[i - 1], p_xn[i], p_fn[i], p_dn[i], 1, &x, &p_ref->f[1], &p_ref->d[1], &p_ref->s[1]);
+			HermiteSpline::cubic_value(p_xn[i], p_fn[i], p_dn[i], p_xn[i + 1], p_fn[i + 1], p_dn[i + 1], 1, &x, &p_ref->f[0], &p_ref->d[0], &p_ref->s[0]);
+			p_ref->sides = 2;
+		}
+	}
+}
+
+// Within float rounding of the reference, relative to the size of the curve's values
+static bool near(float p_val, float p_ref, float p_scale){
+	return fabs(p_val - p_ref) <= 1e-4 * (fabs(p_ref) + p_scale);
+}
+
+static void check(bool p_ok, const char* p_what, float p_x, float p_val, float p_ref){
+	g_checks++;
+
+	if (p_ok)
+		return;
+
+	g_failed++;
+
+	if (g_failed <= 20)
+		printf("FAIL: %s at x = %f: %f, expected %f\n", p_what, p_x, p_val, p_ref);
+}
+
+// Scale of the position, velocity and acceleration of a curve, to judge rounding by
+static void scales(int p_count, float* p_xn, float* p_fn, float* p_dn, float* p_scale){
+	float f = 0;
+	float d = 0;
+	float h = p_xn[p_count - 1] - p_xn[0];
+
+	for (int i = 0; i < p_count; i++){
+		if (fabs(p_fn[i]) > f)
+			f = fabs(p_fn[i]);
+		if (fabs(p_dn[i]) > d)
+			d = fabs(p_dn[i]);
+	}
+
+	for (int i = 0; i < p_count - 1; i++){
+		float slope = fabs((p_fn[i + 1] - p_fn[i]) / (p_xn[i + 1] - p_xn[i]));
+
+		if (slope > d)
+			d = slope;
+		if (p_xn[i + 1] - p_xn[i] < h)
+			h = p_xn[i + 1] - p_xn[i];
+	}
+
+	p_scale[0] = f;
+	p_scale[1] = 3 * d;
+	p_scale[2] = 12 * d / h;
+}
+
+static bool matches(float p_val, float* p_ref, int p_sides, float p_scale){
+	for (int i = 0; i < p_sides; i++){
+		if (near(p_val, p_ref[i], p_scale))
+			return true;
+	}
+	return false;
+}
+
+// A point to check: anywhere from a little before the first key frame to a little after the last, or on a key frame
+static float randomPoint(int p_count, float* p_xn){
+	if (randomFloat(0, 1) < 0.25)
+		return p_xn[(int)randomFloat(0, p_count - 0.01)];
+
+	return randomFloat(p_xn[0] - 20, p_xn[p_count - 1] + 20);
+}
+
+// pos(), vel(), accel() and evaluate() of one axis
+static void checkAxis(KeyFrames* p_kf, int p_count, float* p_xn, float* p_fn, float* p_dn){
+	float scale[3];
+	scales(p_count, p_xn, p_fn, p_dn, scale);
+
+	float points[POINTS];
+
+	for (int i = 0; i < POINTS; i++)
+		points[i] = randomPoint(p_count, p_xn);
+
+	// Half the time in ascending order, as in playback, which moves the cursor forward
+	if (randomFloat(0, 1) < 0.5){
+		for (int i = 1; i < POINTS; i++){
+			for (int j = i; j > 0 && points[j - 1] > points[j]; j--){
+				float t = points[j];
+				points[j] = points[j - 1];
+				points[j - 1] = t;
+			}
+		}
+	}
+
+	for (int i = 0; i < POINTS; i++){
+		float x = points[i];
+		s_ref ref;
+		reference(p_count, p_xn, p_fn, p_dn, x, &ref);
+
+		float pos = p_kf->pos(x);
+		float vel = p_kf->vel(x);
+		float accel = p_kf->accel(x);
+
+		check(matches(pos, ref.f, ref.sides, scale[0]), "pos()", x, pos, ref.f[0]);
+		check(matches(vel, ref.d, ref.sides, scale[1]), "vel()", x, vel, ref.d[0]);
+		check(matches(accel, ref.s, ref.sides, scale[2]), "accel()", x, accel, ref.s[0]);
+
+		// From the start again, rather than the point just calculated
+		p_kf->rewind();
+
+		KeyFrames::s_pva pva;
+		p_kf->evaluate(x, &pva);
+
+		check(matches(pva.pos, ref.f, ref.sides, scale[0]), "evaluate() pos", x, pva.pos, ref.f[0]);
+		check(matches(pva.vel, ref.d, ref.sides, scale[1]), "evaluate() vel", x, pva.vel, ref.d[0]);
+		check(matches(pva.accel, ref.s, ref.sides, scale[2]), "evaluate() accel", x, pva.accel, ref.s[0]);
+	}
+}
+
+// validateVel() and validateAccel() just above and just below the curve's peaks, found by sampling every segment
+static void checkValidate(KeyFrames* p_kf, int p_count, float* p_xn, float* p_fn, float* p_dn){
+	float max_vel = 0;
+	float max_accel = 0;
+	float end_vel = 0;
+
+	for (int i = 0; i < p_count - 1; i++){
+		for (int j = 0; j <= VAL_SAMPLES; j++){
+			float x = p_xn[i] + (p_xn[i + 1] - p_xn[i]) * j / VAL_SAMPLES;
+			float f, d, s;
+
+			HermiteSpline::cubic_value(p_xn[i], p_fn[i], p_dn[i], p_xn[i + 1], p_fn[i + 1], p_dn[i + 1], 1, &x, &f, &d, &s);
+
+			if (fabs(d) > max_vel)
+				max_vel = fabs(d);
+			if (fabs(s) > max_accel)
+				max_accel = fabs(s);
+			if ((j == 0 || j == VAL_SAMPLES) && fabs(d) > end_vel)
+				end_vel = fabs(d);
+		}
+	}
+
+	if (max_vel > end_vel * 1.01)
+		g_interior++;
+
+	KeyFrames::setMaxVel(max_vel * 1.001);
+	check(p_kf->validateVel(), "validateVel() above the peak", 0, 0, max_vel);
+	KeyFrames::setMaxVel(max_vel * 0.999);
+	check(!p_kf->validateVel(), "validateVel() below the peak", 0, 1, max_vel);
+
+	KeyFrames::setMaxAccel(max_accel * 1.001);
+	check(p_kf->validateAccel(), "validateAccel() above the peak", 0, 0, max_accel);
+	KeyFrames::setMaxAccel(max_accel * 0.999);
+	check(!p_kf->validateAccel(), "validateAccel() below the peak", 0, 1, max_accel);
+}
+
+// Key frames are given one at a time, into the memory setKFCount() allocates
+static void setFrames(KeyFrames* p_kf, int p_count, float* p_xn, float* p_fn, float* p_dn){
+	p_kf->setKFCount(p_count);
+
+	for (int i = 0; i < p_count; i++){
+		p_kf->setXN(p_xn[i]);
+		p_kf->setFN(p_fn[i]);
+		p_kf->setDN(p_dn[i]);
+	}
+}
+
+// One axis at a time, reusing the same object so that its coefficients are rebuilt in the memory they already have
+static void checkSingle(int p_trials){
+	KeyFrames kf;
+
+	for (int t = 0; t < p_trials; t++){
+		int count = (int)randomFloat(2, MAX_KF + 0.99);
+		float xn[MAX_KF], fn[MAX_KF], dn[MAX_KF];
+
+		randomFrames(count, randomFloat(-100, 100), xn, fn, dn);
+		setFrames(&kf, count, xn, fn, dn);
+
+		checkAxis(&kf, count, xn, fn, dn);
+		checkValidate(&kf, count, xn, fn, dn);
+	}
+}
+
+// A velocity peak between two key frames which are both at rest must be found
+static void checkInteriorPeak(){
+	KeyFrames kf;
+	float xn[] = { 0, 10 };
+	float fn[] = { 0, 10 };
+	float dn[] = { 0, 0 };
+
+	setFrames(&kf, 2, xn, fn, dn);
+
+	// The velocity of this cubic peaks at 1.5 half way between the key frames
+	KeyFrames::setMaxVel(1.4);
+	check(!kf.validateVel(), "validateVel() with a peak between key frames", 5, 1, 1.5);
+	KeyFrames::setMaxVel(1.6);
+	check(kf.validateVel(), "validateVel() with a peak between key frames", 5, 0, 1.5);
+}
+
+// evaluateAxes() over axes of 0, 1 and several key frames, some of whose ranges don't overlap
+static void checkAxes(int p_trials){
+	for (int t = 0; t < p_trials; t++){
+		int n = (int)randomFloat(1, MAX_AXES + 0.99);
+		KeyFrames* axes = new KeyFrames[n];
+		int count[MAX_AXES];
+		float xn[MAX_AXES][MAX_KF], fn[MAX_AXES][MAX_KF], dn[MAX_AXES][MAX_KF];
+		float lo = 1e9;
+		float hi = -1e9;
+
+		for (int a = 0; a < n; a++){
+			float r = randomFloat(0, 1);
+			count[a] = r < 0.1 ? 0 : r < 0.2 ? 1 : (int)randomFloat(2, MAX_KF + 0.99);
+
+			// Some axes start after others have finished
+			randomFrames(count[a], randomFloat(-100, 1000), xn[a], fn[a], dn[a]);
+		}
+
+		// Axes with a single key frame are given it last, as setFN() only accepts an array once memory has been allocated
+		// for some axis with a curve. Without any such axis, they have none.
+		for (int a = 0; a < n; a++){
+			if (count[a] >= 2){
+				setFrames(&axes[a], count[a], xn[a], fn[a], dn[a]);
+
+				if (xn[a][0] < lo)
+					lo = xn[a][0];
+				if (xn[a][count[a] - 1] > hi)
+					hi = xn[a][count[a] - 1];
+			}
+		}
+
+		for (int a = 0; a < n; a++){
+			if (count[a] == 1 && lo > hi)
+				count[a] = 0;
+
+			if (count[a] < 2)
+				axes[a].setKFCount(count[a]);
+
+			if (count[a] == 1){
+				float* one = (float *)malloc(sizeof(float));
+				*one = fn[a][0];
+				axes[a].setFN(one);
+			}
+		}
+
+		KeyFrames::setAxisArray(axes, n);
+
+		if (lo > hi){
+			lo = 0;
+			hi = 100;
+		}
+
+		for (int i = 0; i < POINTS; i++){
+			float x = randomFloat(lo - 20, hi + 20);
+
+			// On a key frame of some axis
+			int on = (int)randomFloat(0, n - 0.01);
+			if (randomFloat(0, 1) < 0.25 && count[on] >= 2)
+				x = xn[on][(int)randomFloat(0, count[on] - 0.01)];
+
+			float pos[MAX_AXES], vel[MAX_AXES], accel[MAX_AXES];
+			KeyFrames::evaluateAxes(x, pos, vel, accel);
+
+			for (int a = 0; a < n; a++){
+				if (count[a] < 2){
+					float f = count[a] == 1 ? fn[a][0] : 0;
+
+					check(pos[a] == f, "evaluateAxes() pos, short axis", x, pos[a], f);
+					check(vel[a] == 0, "evaluateAxes() vel, short axis", x, vel[a], 0);
+					check(accel[a] == 0, "evaluateAxes() accel, short axis", x, accel[a], 0);
+					continue;
+				}
+
+				float scale[3];
+				s_ref ref;
+				scales(count[a], xn[a], fn[a], dn[a], scale);
+				reference(count[a], xn[a], fn[a], dn[a], x, &ref);
+
+				check(matches(pos[a], ref.f, ref.sides, scale[0]), "evaluateAxes() pos", x, pos[a], ref.f[0]);
+				check(matches(vel[a], ref.d, ref.sides, scale[1]), "evaluateAxes() vel", x, vel[a], ref.d[0]);
+				check(matches(accel[a], ref.s, ref.sides, scale[2]), "evaluateAxes() accel", x, accel[a], ref.s[0]);
+			}
+		}
+
+		KeyFrames::setAxisArray(NULL, 0);
+		delete[] axes;
+	}
+}
+
+int main(int argc, char** argv){
+	int trials = argc > 1 ? atoi(argv[1]) : 500;
+
+	checkSingle(trials);
+	checkInteriorPeak();
+	checkAxes(trials);
+
+	// Random curves must include some whose velocity peaks between key frames, or validateVel() hasn't been tested there
+	check(g_interior > 0, "curves with a velocity peak between key frames", 0, g_interior, 1);
+
+	printf("%lu checks, %lu failed, %lu curves peaking between key frames\n", g_checks, g_failed, g_interior);
+
+	return g_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,18 @@
+#!/bin/sh
+#
+# Builds kfcheck and runs it, see README.md.  Exits non-zero if any check
+# fails.
+#
+# usage: run.sh [trials]   (from this directory, or anywhere else)
+
+cd "$(dirname "$0")" || exit 2
+
+CXX=${CXX:-g++}
+OUT=${TMPDIR:-/tmp}/kfcheck.$$
+
+trap 'rm -f "$OUT"' EXIT
+
+$CXX -O2 -DARDUINO=100 -I. -I../.. -I../../../hermite_spline -o "$OUT" \
+    kfcheck.cpp ../../key_frames.cpp ../../../hermite_spline/hermite_spline.cpp || exit 2
+
+"$OUT" "$@"
@@ -18,15 +18,20 @@ KeyFrames::KeyFrames(){
 	m_fn_recieved = 0;
 	m_dn_recieved = 0;
 	m_kf_count = 0;
+	m_seg = -1;
+	m_x = 0;
+	m_coeffs_valid = false;
+	m_coeffs = NULL;
+	m_coeff_segs = 0;
 }
 
 // Default destructor
 KeyFrames::~KeyFrames(){
 	freeMemory();
+	free(m_coeffs);
 }
 
 // Initialize static class variables
-const int	KeyFrames::G_VALIDATION_PNT_COUNT = 1000;
 int			KeyFrames::g_cur_axis = 0;
 bool		KeyFrames::g_receiving = false;
 int			KeyFrames::g_update_rate = 10;
@@ -36,6 +41,12 @@ int			KeyFrames::g_axis_count = 0;
 float		KeyFrames::g_max_accel = 20000;
 float		KeyFrames::g_max_vel = 4000;
 long		KeyFrames::g_cont_vid_time = -1;
+float*		KeyFrames::g_axes_xn = NULL;
+int			KeyFrames::g_axes_xn_count = 0;
+int			KeyFrames::g_axes_xn_size = 0;
+float*		KeyFrames::g_axes_coeffs = NULL;
+int			KeyFrames::g_axes_coeffs_size = 0;
+int			KeyFrames::g_axes_seg = -1;
 
 /*** Static Functions ***/
 
@@ -53,6 +64,7 @@ long KeyFrames::getContVidTime(){
 void KeyFrames::setAxisArray(KeyFrames* p_axis_array, int p_axis_count){
 	g_axis_array = p_axis_array;
 	g_axis_count = p_axis_count;
+	g_axes_seg = -1;
 }
 
 // Selects the the current axis
@@ -98,6 +110,7 @@ void KeyFrames::setKFCount(int p_kf_count){
 		return;
 
 	m_kf_count = p_kf_count;
+	rewind();
 
 	// Only allocate memory for 2 or more frames. Frame counts of 0 or 1 are just used as indicators
 	if (p_kf_count >= 2){
@@ -129,12 +142,14 @@ void KeyFrames::setXN(float* p_xn){
 		return;
 
 	m_xn = p_xn;
+	rewind();
 }
 
 // Assigns xn values one at a time	
 void KeyFrames::setXN(float p_input){
 	m_xn[m_xn_recieved] = p_input;
 	m_xn_recieved++;
+	rewind();
 }
 
 // Returns the number of xn values that have been assigned. Accurate only when assigning values one at a time.
@@ -177,12 +192,17 @@ void KeyFrames::freeMemory(){
 		
 		g_mem_allocted = false;
 	}
+
+	// The coefficients are rebuilt from the new key frames the next time they're needed, in the same
+	// memory while it is large enough. It is only freed by the destructor.
+	m_coeffs_valid = false;
 }
 
 void KeyFrames::setFN(float* p_fn){
 	if (!g_mem_allocted)
 		return;
 	m_fn = p_fn;
+	rewind();
 }
 
 void KeyFrames::setFN(float p_input){
@@ -190,6 +210,7 @@ void KeyFrames::setFN(float p_input){
 		return;
 	m_fn[m_fn_recieved] = p_input;	
 	m_fn_recieved++;
+	rewind();
 }
 
 int KeyFrames::countFN(){
@@ -209,6 +230,7 @@ void KeyFrames::setDN(float* p_dn){
 	if (!g_mem_allocted)
 		return;
 	m_dn = p_dn;
+	rewind();
 }
 
 void KeyFrames::setDN(float p_input){
@@ -216,6 +238,7 @@ void KeyFrames::setDN(float p_input){
 		return; 
 	m_dn[m_dn_recieved] = p_input;
 	m_dn_recieved++;
+	rewind();
 }
 
 int KeyFrames::countDN(){
@@ -233,40 +256,142 @@ float KeyFrames::getDN(int p_which){
 
 float KeyFrames::pos(float p_x){
 	updateVals(p_x);
-	return m_f[0];
+	return m_pva.pos;
 }
 
 float KeyFrames::vel(float p_x){
 	updateVals(p_x);
-	return m_d[0];
+	return m_pva.vel;
 }
 
 float KeyFrames::accel(float p_x){
 	updateVals(p_x);
-	return m_s[0];
+	return m_pva.accel;
+}
+
+void KeyFrames::evaluate(float p_x, s_pva* p_pva){
+	updateVals(p_x);
+	*p_pva = m_pva;
+}
+
+// Returns the position, velocity and acceleration of every axis at the given x
+void KeyFrames::evaluateAxes(float p_x, float* __restrict__ p_pos, float* __restrict__ p_vel, float* __restrict__ p_accel){
+	float x;
+	int n = g_axis_count;
+
+	// Out of memory. Every axis reads zero until the key frames can be merged.
+	if (g_axes_seg < 0 && !buildAxes()){
+		for (int i = 0; i < n; i++){
+			p_pos[i] = 0;
+			p_vel[i] = 0;
+			p_accel[i] = 0;
+		}
+		return;
+	}
+
+	int seg = 0;
+	float dt = 0;
+
+	// Without two merged key frames no axis has a curve, and all of them hold their values in the only segment
+	if (g_axes_xn_count >= 2){
+
+		// Don't allow requests for x values less than the first point and greater than the last point of any axis
+		if (p_x < g_axes_xn[0])
+			x = g_axes_xn[0];
+		else if (p_x > g_axes_xn[g_axes_xn_count - 1])
+			x = g_axes_xn[g_axes_xn_count - 1];
+		else
+			x = p_x;
+
+		// Same search as updateVals(), over the merged key frames
+		seg = g_axes_seg;
+		HermiteSpline::r8vec_bracket3(g_axes_xn_count, g_axes_xn, x, &seg);
+
+		if (seg < g_axes_xn_count - 2 && x == g_axes_xn[seg + 1])
+			seg++;
+
+		g_axes_seg = seg;
+		dt = x - g_axes_xn[seg];
+	}
+
+	const float* __restrict__ c0 = g_axes_coeffs + seg * 5 * n;
+	const float* __restrict__ c1 = c0 + n;
+	const float* __restrict__ c2 = c1 + n;
+	const float* __restrict__ c3 = c2 + n;
+	const float* __restrict__ k = c3 + n;
+
+	// Each axis is independent of the others and every array is read in order, so on host builds the compiler
+	// can calculate several axes at once with SIMD instructions. The output arrays must not overlap.
+	for (int i = 0; i < n; i++){
+		float t = dt * k[i];
+		float d2 = c2[i] + c2[i];
+		float d3 = 3 * c3[i];
+
+		p_pos[i] = c0[i] + t * (c1[i] + t * (c2[i] + t * c3[i]));
+		p_vel[i] = c1[i] + t * (d2 + t * d3);
+		p_accel[i] = d2 + t * (d3 + d3);
+	}
+}
+
+/*** Playback Cursor Functions ***/
+
+// Returns the playback cursor to the first key frame
+void KeyFrames::rewind(){
+	m_seg = -1;
+	m_coeffs_valid = false;
+	g_axes_seg = -1;
+}
+
+// Returns the segment the playback cursor is in
+int KeyFrames::segment(){
+	return m_seg < 0 ? 0 : m_seg;
 }
 
 /*** Validation Functions ***/
 
 bool KeyFrames::validateVel(){
 
-	float increment = m_xn[m_kf_count - 1] / G_VALIDATION_PNT_COUNT - 1;	
-	
-	for (int i = 0; i < G_VALIDATION_PNT_COUNT; i++){
-		updateVals(i * increment);
-		if (abs(m_d[0]) > g_max_vel)
+	// Out of memory, so the curve can't be checked
+	if (!m_coeffs_valid && !buildCoeffs())
+		return false;
+
+	for (int i = 0; i < m_kf_count - 1; i++){
+		float* c = m_coeffs + 4 * i;
+		float h = m_xn[i + 1] - m_xn[i];
+		float f, d, s;
+
+		// The velocity is a quadratic, so it peaks at one end of the segment or where the acceleration is zero
+		HermiteSpline::cubic_power_value(c, h, &f, &d, &s);
+		if (abs(c[1]) > g_max_vel || abs(d) > g_max_vel)
 			return false;
+
+		if (c[3] != 0){
+			float t = -c[2] / (3 * c[3]);
+
+			if (t > 0 && t < h){
+				HermiteSpline::cubic_power_value(c, t, &f, &d, &s);
+				if (abs(d) > g_max_vel)
+					return false;
+			}
+		}
 	}
 	return true;
 }
 
 bool KeyFrames::validateAccel(){
 
-	float increment = m_xn[m_kf_count - 1] / G_VALIDATION_PNT_COUNT - 1;
-	
-	for (int i = 0; i < G_VALIDATION_PNT_COUNT; i++){
-		updateVals(i * increment);
-		if (abs(m_s[0]) > g_max_accel)
+	// Out of memory, so the curve can't be checked
+	if (!m_coeffs_valid && !buildCoeffs())
+		return false;
+
+	for (int i = 0; i < m_kf_count - 1; i++){
+		float* c = m_coeffs + 4 * i;
+		float h = m_xn[i + 1] - m_xn[i];
+		float f, d, s;
+
+		// The acceleration is a straight line, so it peaks at one end of the segment
+		HermiteSpline::cubic_power_value(c, h, &f, &d, &s);
+		if (abs(c[2] + c[2]) > g_max_accel || abs(s) > g_max_accel)
 			return false;
 	}
 	return true;
@@ -283,15 +408,194 @@ void KeyFrames::setMaxAccel(float p_max_accel){
 /*** Non-Static Private Functions ***/
 
 void KeyFrames::updateVals(float p_x){
-	float x_point[1];
+	float x;
 	
 	// Don't allow requests for x values less than the first point and greater than the last point
 	if (p_x < m_xn[0])
-		x_point[0] = m_xn[0];
-	else if (p_x > m_xn[m_xn_recieved - 1])
-		x_point[0] = m_xn[m_xn_recieved - 1];
+		x = m_xn[0];
+	else if (p_x > m_xn[m_kf_count - 1])
+		x = m_xn[m_kf_count - 1];
 	else
-		x_point[0] = p_x;
+		x = p_x;
+
+	// Already calculated
+	if (m_seg >= 0 && x == m_x)
+		return;
+
+	// Out of memory. The axis reads zero until the coefficients can be calculated.
+	if (!m_coeffs_valid && !buildCoeffs()){
+		m_pva.pos = 0;
+		m_pva.vel = 0;
+		m_pva.accel = 0;
+		return;
+	}
+
+	// Playback moves forward one update at a time, so x is almost always in the cursor's
+	// segment or the next one, both of which r8vec_bracket3() checks before searching
+	int seg = m_seg < 0 ? 0 : m_seg;
+	HermiteSpline::r8vec_bracket3(m_kf_count, m_xn, x, &seg);
+
+	// A point on a key frame may be bracketed by the segment either side of it, depending on where
+	// the search started. Always use the one starting there so the result doesn't depend on the cursor.
+	if (seg < m_kf_count - 2 && x == m_xn[seg + 1])
+		seg++;
+
+	m_seg = seg;
+	m_x = x;
+	HermiteSpline::cubic_power_value(m_coeffs + 4 * seg, x - m_xn[seg], &m_pva.pos, &m_pva.vel, &m_pva.accel);
+}
 
-	HermiteSpline::cubic_spline_value(m_kf_count, m_xn, m_fn, m_dn, 1, x_point, m_f, m_d, m_s);
+// Returns false if the coefficients could not be allocated
+bool KeyFrames::buildCoeffs(){
+	int segs = m_kf_count - 1;
+
+	// Reuse the memory while it is large enough
+	if (segs > m_coeff_segs){
+		free(m_coeffs);
+		m_coeffs = (float *)malloc(segs * 4 * sizeof(float));
+
+		if (m_coeffs == NULL){
+			m_coeff_segs = 0;
+			return false;
+		}
+
+		m_coeff_segs = segs;
+	}
+
+	for (int i = 0; i < segs; i++)
+		HermiteSpline::cubic_power_coefficients(m_xn[i], m_fn[i], m_dn[i], m_xn[i + 1], m_fn[i + 1], m_dn[i + 1], m_coeffs + 4 * i);
+
+	m_coeffs_valid = true;
+	return true;
+}
+
+/*** Static Private Functions ***/
+
+/*
+	The coefficients of merged segment j are stored as 5 rows of one float per axis: the value and first derivative
+	of the axis at the start of the segment, half its second derivative, its cubic coefficient, and a multiplier
+	for the distance into the segment. Inside the axis's own key frames the multiplier is 1 and the rows are the
+	axis's cubic re-expanded about the start of the merged segment. Outside them it is 0, and the first three rows
+	are the values at the axis's first or last key frame, which are then returned unchanged.
+
+	An axis with a single key frame holds its value everywhere, and one with no key frames holds zero. Neither
+	adds to the merged key frames, and when no axis has a curve there is still one segment to hold the values in.
+
+	Returns false if the buffers could not be allocated.
+*/
+bool KeyFrames::buildAxes(){
+
+	// Merge the abscissas of every axis with a curve into one ascending list without duplicates
+	int max_count = 0;
+	for (int a = 0; a < g_axis_count; a++){
+		if (g_axis_array[a].m_kf_count >= 2)
+			max_count += g_axis_array[a].m_kf_count;
+	}
+
+	g_axes_xn_count = 0;
+
+	if (!growBuffer(&g_axes_xn, &g_axes_xn_size, max_count))
+		return false;
+
+	for (int a = 0; a < g_axis_count; a++){
+		KeyFrames* axis = &g_axis_array[a];
+
+		if (axis->m_kf_count < 2)
+			continue;
+
+		for (int i = 0; i < axis->m_kf_count; i++){
+			float x = axis->m_xn[i];
+			int j = g_axes_xn_count;
+
+			while (j > 0 && g_axes_xn[j - 1] > x)
+				j--;
+
+			if (j > 0 && g_axes_xn[j - 1] == x)
+				continue;
+
+			for (int k = g_axes_xn_count; k > j; k--)
+				g_axes_xn[k] = g_axes_xn[k - 1];
+
+			g_axes_xn[j] = x;
+			g_axes_xn_count++;
+		}
+	}
+
+	int n = g_axis_count;
+	int segs = g_axes_xn_count >= 2 ? g_axes_xn_count - 1 : 1;
+
+	if (!growBuffer(&g_axes_coeffs, &g_axes_coeffs_size, segs * 5 * n)){
+		g_axes_xn_count = 0;
+		return false;
+	}
+
+	for (int j = 0; j < segs; j++){
+		float* c = g_axes_coeffs + j * 5 * n;
+
+		for (int a = 0; a < n; a++){
+			KeyFrames* axis = &g_axis_array[a];
+			int last = axis->m_kf_count - 1;
+			float start;
+			float k;
+
+			if (axis->m_kf_count < 2){
+				c[a] = (axis->m_kf_count == 1 && axis->m_fn != NULL) ? axis->m_fn[0] : 0;
+				c[n + a] = 0;
+				c[2 * n + a] = 0;
+				c[3 * n + a] = 0;
+				c[4 * n + a] = 0;
+				continue;
+			}
+
+			if (g_axes_xn[j + 1] <= axis->m_xn[0]){
+				start = axis->m_xn[0];
+				k = 0;
+			}
+			else if (g_axes_xn[j] >= axis->m_xn[last]){
+				start = axis->m_xn[last];
+				k = 0;
+			}
+			else {
+				start = g_axes_xn[j];
+				k = 1;
+			}
+
+			// The axis segment covering this merged segment, or the nearest one outside the axis's key frames
+			int i = 0;
+			HermiteSpline::r8vec_bracket3(axis->m_kf_count, axis->m_xn, (g_axes_xn[j] + g_axes_xn[j + 1]) / 2, &i);
+
+			float seg[4];
+			float f, d, s;
+			HermiteSpline::cubic_power_coefficients(axis->m_xn[i], axis->m_fn[i], axis->m_dn[i], axis->m_xn[i + 1], axis->m_fn[i + 1], axis->m_dn[i + 1], seg);
+			HermiteSpline::cubic_power_value(seg, start - axis->m_xn[i], &f, &d, &s);
+
+			c[a] = f;
+			c[n + a] = d;
+			c[2 * n + a] = s / 2;
+			c[3 * n + a] = seg[3];
+			c[4 * n + a] = k;
+		}
+	}
+
+	g_axes_seg = 0;
+	return true;
+}
+
+// Makes sure a buffer holds at least the given number of floats. Buffers are only ever grown, so merging the
+// key frames again after they change doesn't fragment the heap. Returns false if the buffer could not be allocated.
+bool KeyFrames::growBuffer(float** p_buf, int* p_size, int p_count){
+
+	if (p_count <= *p_size)
+		return true;
+
+	free(*p_buf);
+	*p_buf = (float *)malloc(p_count * sizeof(float));
+
+	if (*p_buf == NULL){
+		*p_size = 0;
+		return false;
+	}
+
+	*p_size = p_count;
+	return true;
 }
\ No newline at end of file
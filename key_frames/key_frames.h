@@ -45,6 +45,13 @@ class KeyFrames{
 
 public:
 
+	// Position, velocity and acceleration of the curve at one point
+	struct s_pva {
+		float pos;
+		float vel;
+		float accel;
+	};
+
 	KeyFrames();										// Default constructor
 	~KeyFrames();										// Default destructor
 
@@ -99,10 +106,17 @@ public:
 	float pos(float p_x);								// Returns the position rate at the given x
 	float vel(float p_x);								// Returns the velocity at the given x
 	float accel(float p_x);								// Returns the acceleration at the given x
+	void evaluate(float p_x, s_pva* p_pva);				// Returns the position, velocity and acceleration at the given x from a single calculation
+	static void evaluateAxes(float p_x, float* p_pos,	// Returns the position, velocity and acceleration of every axis at the given x, one array entry per axis
+		float* p_vel, float* p_accel);
+
+	// Playback cursor functions
+	void rewind();										// Returns the playback cursor to the first key frame. Called automatically whenever the key frames change
+	int segment();										// Returns the segment (index of its first key frame) the playback cursor is in
 
 	// Validation functions
-	bool validateVel();									// Returns true if curve does not exceed max motor speed
-	bool validateAccel();								// Returns true if curve does not exceed max motor accel
+	bool validateVel();									// Returns true if curve does not exceed max motor speed anywhere between the first and last key frames
+	bool validateAccel();								// Returns true if curve does not exceed max motor accel anywhere between the first and last key frames
 	static void setMaxVel(float p_max_vel);				// Sets the maximum velocity for validation checking
 	static void setMaxAccel(float p_max_accel);			// Sets the maximum acceleration for validation checking
 	
@@ -126,19 +140,37 @@ private:
 	float* m_xn;										// Abscissas of key frame locations
 	float* m_fn;										// Ordinate of current axis key frame location
 	float* m_dn;										// Derivatives at key frame locations
-	float m_f[1];										// Current axis curve's location at calculated point
-	float m_d[1];										// Current axis curve's first derivative at calculated point
-	float m_s[1];										// Current axis curve's second derivative at calculated point
+	s_pva m_pva;										// Current axis curve's location and first two derivatives at calculated point
+	float m_x;											// The calculated point. Only valid while m_seg >= 0
 	
 	void updateVals(float p_x);							// Updates the output vars for the given locations
 
+	// Playback cursor vars
+	int m_seg;											// Segment holding the last calculated point, or -1 when no point has been calculated since the cursor was returned
+	bool m_coeffs_valid;								// Indicates whether m_coeffs matches the current key frames
+	float* m_coeffs;									// Power basis coefficients of each segment, 4 per segment
+	int m_coeff_segs;									// Number of segments m_coeffs has been allocated for
+
+	bool buildCoeffs();									// Calculates the coefficients of every segment from the key frames. Returns false if out of memory
+
+	// Multi-axis vars
+	static float* g_axes_xn;							// Abscissas of every axis's key frames, merged into one ascending list
+	static int g_axes_xn_count;							// Number of merged abscissas
+	static int g_axes_xn_size;							// Number of floats g_axes_xn has been allocated for
+	static float* g_axes_coeffs;						// Coefficients of every axis for each merged segment, see buildAxes()
+	static int g_axes_coeffs_size;						// Number of floats g_axes_coeffs has been allocated for
+	static int g_axes_seg;								// Merged segment holding the last calculated point, or -1 when the coefficients must be rebuilt
+
+	static bool buildAxes();							// Merges the key frames of every axis and calculates their coefficients. Returns false if out of memory
+	static bool growBuffer(float** p_buf, int* p_size,	// Grows a buffer to hold at least the given number of floats. Returns false if out of memory
+		int p_count);
+
 	// Validation vars
-	static const int G_VALIDATION_PNT_COUNT;			// Number of points to check on spline for validation purposes
 	static float g_max_vel;								// Absolute maximum velocity
 	static float g_max_accel;							// Absolute maximum acceleration
 
 	// Memory management
-	void freeMemory();									// Deallocates any memory assigned to input arrays
+	void freeMemory();									// Deallocates any memory assigned to input arrays. The coefficients are kept for reuse
 };
 
 #endif
@@ -168,7 +200,39 @@ private:
 	   things may go horribly wrong. Additionally, the abscissa values must be strictly sorted in ascending order for the same reason.
 
 	5. Once steps 1-4 have been completed, the position, velocity, or acceleration at any x location between the first and last
-	   key frame abscissa may be retrieved with the pos(float p_x), vel(float p_x), accel(float p_x) functions.
+	   key frame abscissa may be retrieved with the pos(float p_x), vel(float p_x), accel(float p_x) functions. When more than
+	   one of them is needed at the same x, evaluate(float p_x, s_pva* p_pva) returns all three from a single calculation.
+	   The last point calculated is remembered, so asking for the same x again (for instance, calling pos(), vel() and
+	   accel() in turn) does not recalculate it.
+
+	Each object keeps a playback cursor on the key frame segment that it last calculated a point in, along with that
+	segment's coefficients. Program playback requests points in ascending order, one updateRate() apart, so the next
+	point is almost always in the same segment or the one following it, and is found without searching the key frames.
+	Points may still be requested in any order; a jump backwards or across several segments costs one binary search.
+	The cursor is returned to the first key frame whenever key frame values are assigned, or by calling rewind(). If
+	the arrays passed to setXN(float* p_xn), setFN(float* p_fn) or setDN(float* p_dn) are changed afterwards, call
+	rewind() before requesting any more points.
+
+	The first point requested after the cursor is returned converts every segment to the power basis coefficients
+	of its cubic, which are kept in one array of 4 floats per segment. Every point after that is calculated from the
+	coefficients alone by Horner's rule, rather than re-deriving the cubic from the key frames. The array is kept
+	when the key frame count changes, and reused while it is large enough, so it is only freed with the object.
+
+	All axes may also be calculated together with the static function evaluateAxes(float p_x, float* p_pos,
+	float* p_vel, float* p_accel), which fills one entry per axis of three separate output arrays. The key frames of every axis
+	are merged into one list of segments, and the coefficients of all axes are stored together for each segment, so
+	that one search finds the segment for every axis and the axes are calculated by a single loop over contiguous
+	arrays (which the compiler can vectorize on host builds). An axis outside its own first and last key frames
+	holds the values at that key frame, as pos(), vel() and accel() do. An axis with a single key frame holds its
+	value, and one with none reads zero. The merged coefficients take 20 bytes per axis for every distinct key frame
+	location, and are rebuilt on the next call after any axis's key frames change, reusing their memory when it is
+	large enough. If the memory cannot be allocated, every axis reads zero.
+
+	validateVel() and validateAccel() check the curve against the limits set by setMaxVel(float p_max_vel) and
+	setMaxAccel(float p_max_accel) exactly, from the coefficients of each segment, rather than by sampling it. Within
+	a segment the velocity is a quadratic, whose largest magnitude is at one end of the segment or at its turning
+	point, and the acceleration is a straight line, whose largest magnitude is at one end. A peak between key frames
+	is therefore never missed, and each check takes a few calculations per segment.
 
 */
 